@@ -7,8 +7,8 @@ class IBehaviourTreeActionNode : public IBehaviourTreeNodeBehaviour {
 	GDCLASS(IBehaviourTreeActionNode, IBehaviourTreeNodeBehaviour);
 
 public:
-	bool GetChildrens(std::vector<IBehaviourTreeNodeBehaviour *> &) const final {
-		return false;
+	NodeChildrens GetChildrens() const final {
+		return {};
 	}
 };
 } //namespace behaviour_tree
@@ -0,0 +1,258 @@
+#include "buffer_reader.hpp"
+
+namespace behaviour_tree {
+uint32_t BufferReader::GetArraySize(uint32_t min_element_size) {
+	// a corrupted size can't make the arrays allocate more than the file could hold
+	const uint32_t size = Get32();
+	if (static_cast<uint64_t>(size) * min_element_size > m_Size - m_Position) {
+		m_Position = m_Size;
+		m_HasError = true;
+		return 0;
+	}
+	return size;
+}
+
+uint32_t BufferReader::GetVarCount(uint32_t min_element_size) {
+	const uint32_t count = GetVarInt();
+	if (static_cast<uint64_t>(count) * min_element_size > m_Size - m_Position) {
+		m_Position = m_Size;
+		m_HasError = true;
+		return 0;
+	}
+	return count;
+}
+
+String BufferReader::GetString() {
+	const uint32_t length = Get32();
+	if (!length) {
+		Get8();
+		return String();
+	}
+	return GetUtf8(length);
+}
+
+String BufferReader::GetUtf8(uint32_t length) {
+	String str;
+	if (length > m_Size - m_Position) {
+		m_Position = m_Size;
+		m_HasError = true;
+	} else if (length) {
+		str.parse_utf8(reinterpret_cast<const char *>(m_Data + m_Position), length);
+		m_Position += length;
+	}
+	return str;
+}
+
+Variant BufferReader::GetVariant() {
+	switch (Get8()) {
+		case Variant::BOOL:
+			return static_cast<bool>(Get8());
+			break;
+		case Variant::INT:
+			return static_cast<int>(Get32());
+			break;
+		case Variant::FLOAT:
+			return static_cast<float>(GetFloat());
+			break;
+		case Variant::STRING:
+			return GetString();
+			break;
+
+		case Variant::VECTOR2: {
+			Vector2 val;
+			GetBuffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
+			return val;
+		}
+		case Variant::VECTOR2I: {
+			Vector2i val;
+			GetBuffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
+			return val;
+		}
+		case Variant::RECT2: {
+			Rect2 val;
+			GetBuffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
+			return val;
+		}
+		case Variant::RECT2I: {
+			Rect2i val;
+			GetBuffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
+			return val;
+		}
+		case Variant::VECTOR3: {
+			Vector3 val;
+			GetBuffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
+			return val;
+		}
+		case Variant::VECTOR3I: {
+			Vector3i val;
+			GetBuffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
+			return val;
+		}
+		case Variant::TRANSFORM2D: {
+			Transform2D val;
+			GetBuffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
+			return val;
+		}
+		case Variant::VECTOR4: {
+			Vector4 val;
+			GetBuffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
+			return val;
+		}
+		case Variant::VECTOR4I: {
+			Vector4i val;
+			GetBuffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
+			return val;
+		}
+		case Variant::PLANE: {
+			Plane val;
+			GetBuffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
+			return val;
+		}
+		case Variant::QUATERNION: {
+			Quaternion val;
+			GetBuffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
+			return val;
+		}
+		case Variant::AABB: {
+			AABB val;
+			GetBuffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
+			return val;
+		}
+		case Variant::BASIS: {
+			Basis val;
+			GetBuffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
+			return val;
+		}
+		case Variant::TRANSFORM3D: {
+			Transform3D val;
+			GetBuffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
+			return val;
+		}
+		case Variant::PROJECTION: {
+			Projection val;
+			GetBuffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
+			return val;
+		}
+
+		// misc types
+		case Variant::COLOR: {
+			Color val;
+			GetBuffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
+			return val;
+		}
+		case Variant::STRING_NAME: {
+			return GetString();
+			break;
+		}
+		case Variant::NODE_PATH: {
+			return NodePath(GetString());
+		}
+		case Variant::RID: {
+			RID val;
+			GetBuffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
+			return val;
+		}
+		case Variant::OBJECT: {
+			Object *val = ObjectDB::get_instance(ObjectID(Get64()));
+			if (!val)
+				ERR_PRINT("Invalid Object passed in Variant");
+			return val;
+		}
+		case Variant::CALLABLE: {
+			Callable val;
+			GetBuffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
+			if (val.is_custom() || val.is_null())
+				ERR_PRINT("Invalid Callable passed in Variant");
+			return val;
+		}
+		case Variant::SIGNAL: {
+			Signal val;
+			GetBuffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
+			return val;
+		}
+		case Variant::DICTIONARY: {
+			Dictionary val;
+			const uint32_t size = GetArraySize(2);
+			for (uint32_t i = 0; i < size; i++) {
+				Variant key = GetVariant();
+				Variant value = GetVariant();
+				val[key] = value;
+			}
+			return val;
+		}
+		case Variant::ARRAY: {
+			Array val;
+			const int size = static_cast<int>(GetArraySize(1));
+			val.resize(size);
+
+			for (int i = 0; i < size; i++)
+				val[i] = GetVariant();
+			return val;
+		}
+
+		// typed arrays, sized once and copied as a block
+		case Variant::PACKED_BYTE_ARRAY: {
+			PackedByteArray val;
+			val.resize(GetArraySize(1));
+			GetBuffer(val.ptrw(), val.size());
+			return val;
+		}
+		case Variant::PACKED_INT32_ARRAY: {
+			PackedInt32Array val;
+			val.resize(GetArraySize(sizeof(int32_t)));
+			GetScalars(val.ptrw(), val.size());
+			return val;
+		}
+		case Variant::PACKED_INT64_ARRAY: {
+			PackedInt64Array val;
+			val.resize(GetArraySize(sizeof(int64_t)));
+			GetScalars(val.ptrw(), val.size());
+			return val;
+		}
+		case Variant::PACKED_FLOAT32_ARRAY: {
+			PackedFloat32Array val;
+			val.resize(GetArraySize(sizeof(float)));
+			GetScalars(val.ptrw(), val.size());
+			return val;
+		}
+		case Variant::PACKED_FLOAT64_ARRAY: {
+			PackedFloat64Array val;
+			val.resize(GetArraySize(sizeof(double)));
+			GetScalars(val.ptrw(), val.size());
+			return val;
+		}
+		case Variant::PACKED_STRING_ARRAY: {
+			PackedStringArray val;
+			val.resize(GetArraySize(sizeof(uint32_t) + 1));
+
+			String *strings = val.ptrw();
+			for (int i = 0; i < val.size(); i++)
+				strings[i] = GetString();
+			return val;
+		}
+		case Variant::PACKED_VECTOR2_ARRAY: {
+			PackedVector2Array val;
+			val.resize(GetArraySize(sizeof(float) * 2));
+			GetVectors<2>(val.ptrw(), val.size());
+			return val;
+		}
+		case Variant::PACKED_VECTOR3_ARRAY: {
+			PackedVector3Array val;
+			val.resize(GetArraySize(sizeof(float) * 3));
+			GetVectors<3>(val.ptrw(), val.size());
+			return val;
+		}
+		case Variant::PACKED_COLOR_ARRAY: {
+			PackedColorArray val;
+			val.resize(GetArraySize(sizeof(float) * 4));
+			GetVectors<4>(val.ptrw(), val.size());
+			return val;
+		}
+
+		default: {
+			ERR_PRINT("Invalid variant in Behaviour Tree");
+			return Variant{};
+		}
+	}
+}
+} //namespace behaviour_tree
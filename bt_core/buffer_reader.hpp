@@ -0,0 +1,139 @@
+#pragma once
+
+#include "core/variant/variant.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace behaviour_tree {
+/*
+Cursor over a file loaded in memory, reads the little-endian layout of FileAccess without a call per value.
+Reading past the end returns zeros and sets the error, the result is checked once the whole file is parsed.
+*/
+class BufferReader {
+public:
+	BufferReader(const uint8_t *data, uint64_t size) noexcept :
+			m_Data(data),
+			m_Size(size) {}
+
+	uint8_t Get8() noexcept {
+		return GetScalar<uint8_t>();
+	}
+	uint16_t Get16() noexcept {
+		return GetScalar<uint16_t>();
+	}
+	uint32_t Get32() noexcept {
+		return GetScalar<uint32_t>();
+	}
+	uint64_t Get64() noexcept {
+		return GetScalar<uint64_t>();
+	}
+	float GetFloat() noexcept {
+		return GetScalar<float>();
+	}
+	double GetDouble() noexcept {
+		return GetScalar<double>();
+	}
+
+	// 7 bits per byte, the high bit is set on all the bytes but the last
+	uint32_t GetVarInt() noexcept {
+		uint32_t value = 0;
+		for (uint32_t shift = 0; shift < 35; shift += 7) {
+			const uint8_t byte = Get8();
+			value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+			if (!(byte & 0x80))
+				break;
+		}
+		return value;
+	}
+
+	bool GetBuffer(uint8_t *dst, uint64_t length) noexcept {
+		if (!length)
+			return true;
+		if (length > m_Size - m_Position) {
+			std::fill_n(dst, length, uint8_t(0));
+			m_Position = m_Size;
+			m_HasError = true;
+			return false;
+		}
+		std::memcpy(dst, m_Data + m_Position, length);
+		m_Position += length;
+		return true;
+	}
+
+	// Reads 'count' scalars of the same type in one copy
+	template <typename _Ty>
+	void GetScalars(_Ty *dst, uint64_t count) noexcept {
+		if (!GetBuffer(reinterpret_cast<uint8_t *>(dst), count * sizeof(_Ty)))
+			return;
+#ifdef BIG_ENDIAN_ENABLED
+		for (uint64_t i = 0; i < count; i++)
+			SwapBytes(dst[i]);
+#endif
+	}
+
+	// Varint number of elements of at least 'min_element_size' bytes, 0 with the error set if the rest of the file
+	// is too short to hold them
+	uint32_t GetVarCount(uint32_t min_element_size);
+
+	// Pascal string, an empty one is followed by a byte
+	String GetString();
+	// 'length' bytes of utf8, decoded in place
+	String GetUtf8(uint32_t length);
+	Variant GetVariant();
+
+	uint64_t GetPosition() const noexcept {
+		return m_Position;
+	}
+	void Seek(uint64_t position) noexcept {
+		m_Position = std::min(position, m_Size);
+	}
+	uint64_t GetSize() const noexcept {
+		return m_Size;
+	}
+	bool IsEof() const noexcept {
+		return m_Position >= m_Size;
+	}
+	bool HasError() const noexcept {
+		return m_HasError;
+	}
+
+private:
+	// Size of an array, or 0 if the file is too short to hold it
+	uint32_t GetArraySize(uint32_t min_element_size);
+
+	// Vectors and colors are stored as floats, copied as a block when their components are floats too
+	template <int _Components, typename _Ty>
+	void GetVectors(_Ty *dst, uint64_t count) noexcept {
+		if constexpr (sizeof(_Ty) == sizeof(float) * _Components)
+			GetScalars(reinterpret_cast<float *>(dst), count * _Components);
+		else {
+			for (uint64_t i = 0; i < count; i++) {
+				for (int c = 0; c < _Components; c++)
+					dst[i][c] = GetFloat();
+			}
+		}
+	}
+
+	template <typename _Ty>
+	_Ty GetScalar() noexcept {
+		_Ty value{};
+		GetScalars(&value, 1);
+		return value;
+	}
+
+#ifdef BIG_ENDIAN_ENABLED
+	template <typename _Ty>
+	static void SwapBytes(_Ty &value) noexcept {
+		uint8_t *bytes = reinterpret_cast<uint8_t *>(&value);
+		std::reverse(bytes, bytes + sizeof(_Ty));
+	}
+#endif
+
+private:
+	const uint8_t *m_Data;
+	uint64_t m_Size;
+	uint64_t m_Position = 0;
+	bool m_HasError = false;
+};
+} //namespace behaviour_tree
@@ -0,0 +1,232 @@
+#include "buffer_writer.hpp"
+
+namespace behaviour_tree {
+void BufferWriter::StoreString(const String &str) {
+	if (str.is_empty()) {
+		Store32(0);
+		Store8(0);
+		return;
+	}
+
+	CharString cs = str.utf8();
+	Store32(static_cast<uint32_t>(cs.length()));
+	StoreBuffer(reinterpret_cast<const uint8_t *>(cs.get_data()), cs.length());
+}
+
+uint32_t BufferWriter::StoreUtf8(const String &str) {
+	CharString cs = str.utf8();
+	StoreBuffer(reinterpret_cast<const uint8_t *>(cs.get_data()), cs.length());
+	return static_cast<uint32_t>(cs.length());
+}
+
+void BufferWriter::StoreVariant(const Variant &var) {
+	Store8(var.get_type());
+	switch (var.get_type()) {
+		case Variant::BOOL:
+			Store8(var.operator bool());
+			break;
+		case Variant::INT:
+			Store32(var.operator int());
+			break;
+		case Variant::FLOAT:
+			StoreFloat(var);
+			break;
+		case Variant::STRING:
+			StoreString(var);
+			break;
+
+		case Variant::VECTOR2: {
+			Vector2 val = var;
+			StoreBuffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
+			break;
+		}
+		case Variant::VECTOR2I: {
+			Vector2i val = var;
+			StoreBuffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
+			break;
+		}
+		case Variant::RECT2: {
+			Rect2 val = var;
+			StoreBuffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
+			break;
+		}
+		case Variant::RECT2I: {
+			Rect2i val = var;
+			StoreBuffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
+			break;
+		}
+		case Variant::VECTOR3: {
+			Vector3 val = var;
+			StoreBuffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
+			break;
+		}
+		case Variant::VECTOR3I: {
+			Vector3i val = var;
+			StoreBuffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
+			break;
+		}
+		case Variant::TRANSFORM2D: {
+			Transform2D val = var;
+			StoreBuffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
+			break;
+		}
+		case Variant::VECTOR4: {
+			Vector4 val = var;
+			StoreBuffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
+			break;
+		}
+		case Variant::VECTOR4I: {
+			Vector4i val = var;
+			StoreBuffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
+			break;
+		}
+		case Variant::PLANE: {
+			Plane val = var;
+			StoreBuffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
+			break;
+		}
+		case Variant::QUATERNION: {
+			Quaternion val = var;
+			StoreBuffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
+			break;
+		}
+		case Variant::AABB: {
+			AABB val = var;
+			StoreBuffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
+			break;
+		}
+		case Variant::BASIS: {
+			Basis val = var;
+			StoreBuffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
+			break;
+		}
+		case Variant::TRANSFORM3D: {
+			Transform3D val = var;
+			StoreBuffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
+			break;
+		}
+		case Variant::PROJECTION: {
+			Projection val = var;
+			StoreBuffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
+			break;
+		}
+
+		// misc types
+		case Variant::COLOR: {
+			Color color = var;
+			StoreBuffer(reinterpret_cast<const uint8_t *>(&color), sizeof(color));
+			break;
+		}
+		case Variant::STRING_NAME: {
+			StoreString(var);
+			break;
+		}
+		case Variant::NODE_PATH: {
+			NodePath val = var;
+			StoreString(val);
+			break;
+		}
+		case Variant::RID: {
+			RID val = var;
+			StoreBuffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
+			break;
+		}
+		case Variant::OBJECT: {
+			Object *val = var;
+			Store64(val->get_instance_id());
+			break;
+		}
+		case Variant::CALLABLE: {
+			Callable val = var;
+			ERR_FAIL_COND_MSG(val.is_custom() || val.is_null(), "Invalid Callable passed in Variant");
+			StoreBuffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
+			break;
+		}
+		case Variant::SIGNAL: {
+			Signal val = var;
+			StoreBuffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
+			break;
+		}
+		case Variant::DICTIONARY: {
+			Dictionary val = var;
+			auto keys = val.keys();
+			auto vals = val.values();
+			Store32(val.size());
+			for (int i = 0; i < val.size(); i++) {
+				StoreVariant(keys[i]);
+				StoreVariant(vals[i]);
+			}
+			break;
+		}
+		case Variant::ARRAY: {
+			Array val = var;
+			Store32(val.size());
+			for (int i = 0; i < val.size(); i++)
+				StoreVariant(val[i]);
+			break;
+		}
+
+		// typed arrays, written as a block
+		case Variant::PACKED_BYTE_ARRAY: {
+			PackedByteArray val = var;
+			Store32(val.size());
+			StoreBuffer(val.ptr(), val.size());
+			break;
+		}
+		case Variant::PACKED_INT32_ARRAY: {
+			PackedInt32Array val = var;
+			Store32(val.size());
+			StoreScalars(val.ptr(), val.size());
+			break;
+		}
+		case Variant::PACKED_INT64_ARRAY: {
+			PackedInt64Array val = var;
+			Store32(val.size());
+			StoreScalars(val.ptr(), val.size());
+			break;
+		}
+		case Variant::PACKED_FLOAT32_ARRAY: {
+			PackedFloat32Array val = var;
+			Store32(val.size());
+			StoreScalars(val.ptr(), val.size());
+			break;
+		}
+		case Variant::PACKED_FLOAT64_ARRAY: {
+			PackedFloat64Array val = var;
+			Store32(val.size());
+			StoreScalars(val.ptr(), val.size());
+			break;
+		}
+		case Variant::PACKED_STRING_ARRAY: {
+			PackedStringArray val = var;
+			Store32(val.size());
+			for (int i = 0; i < val.size(); i++)
+				StoreString(val[i]);
+			break;
+		}
+		case Variant::PACKED_VECTOR2_ARRAY: {
+			PackedVector2Array val = var;
+			Store32(val.size());
+			StoreVectors<2>(val.ptr(), val.size());
+			break;
+		}
+		case Variant::PACKED_VECTOR3_ARRAY: {
+			PackedVector3Array val = var;
+			Store32(val.size());
+			StoreVectors<3>(val.ptr(), val.size());
+			break;
+		}
+		case Variant::PACKED_COLOR_ARRAY: {
+			PackedColorArray val = var;
+			Store32(val.size());
+			StoreVectors<4>(val.ptr(), val.size());
+			break;
+		}
+
+		default: {
+			ERR_FAIL_COND_MSG(var.get_type() == Variant::NIL || var.is_null(), "Invalid variant in Behaviour Tree");
+		}
+	}
+}
+
+} //namespace behaviour_tree
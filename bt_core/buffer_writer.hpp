@@ -0,0 +1,110 @@
+#pragma once
+
+#include "core/io/file_access.h"
+#include "core/variant/variant.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace behaviour_tree {
+/*
+Growable buffer a whole file is serialized into before it is written with a single call, in the little-endian
+layout of FileAccess read back by BufferReader.
+*/
+class BufferWriter {
+public:
+	void Store8(uint8_t value) {
+		StoreScalar(value);
+	}
+	void Store16(uint16_t value) {
+		StoreScalar(value);
+	}
+	void Store32(uint32_t value) {
+		StoreScalar(value);
+	}
+	void Store64(uint64_t value) {
+		StoreScalar(value);
+	}
+	void StoreFloat(float value) {
+		StoreScalar(value);
+	}
+	void StoreDouble(double value) {
+		StoreScalar(value);
+	}
+
+	// 7 bits per byte, the high bit is set on all the bytes but the last
+	void StoreVarInt(uint32_t value) {
+		while (value >= 0x80) {
+			m_Data.push_back(static_cast<uint8_t>(value | 0x80));
+			value >>= 7;
+		}
+		m_Data.push_back(static_cast<uint8_t>(value));
+	}
+
+	void StoreBuffer(const uint8_t *src, uint64_t length) {
+		if (!length)
+			return;
+		const size_t offset = m_Data.size();
+		m_Data.resize(offset + length);
+		std::memcpy(m_Data.data() + offset, src, length);
+	}
+
+	// Writes 'count' scalars of the same type in one copy
+	template <typename _Ty>
+	void StoreScalars(const _Ty *src, uint64_t count) {
+		const size_t offset = m_Data.size();
+		StoreBuffer(reinterpret_cast<const uint8_t *>(src), count * sizeof(_Ty));
+#ifdef BIG_ENDIAN_ENABLED
+		for (uint64_t i = 0; i < count; i++)
+			std::reverse(m_Data.data() + offset + i * sizeof(_Ty), m_Data.data() + offset + (i + 1) * sizeof(_Ty));
+#else
+		(void)offset;
+#endif
+	}
+
+	// Pascal string, an empty one is followed by a byte
+	void StoreString(const String &str);
+	// Utf8 bytes of the string without their length, returns the length
+	uint32_t StoreUtf8(const String &str);
+	void StoreVariant(const Variant &var);
+
+	const uint8_t *GetData() const noexcept {
+		return m_Data.data();
+	}
+	uint64_t GetSize() const noexcept {
+		return m_Data.size();
+	}
+
+	void Reserve(size_t size) {
+		m_Data.reserve(size);
+	}
+
+	Error Flush(Ref<FileAccess> &file) const {
+		file->store_buffer(m_Data.data(), m_Data.size());
+		return file->get_error();
+	}
+
+private:
+	template <typename _Ty>
+	void StoreScalar(_Ty value) {
+		StoreScalars(&value, 1);
+	}
+
+	// Vectors and colors are stored as floats, copied as a block when their components are floats too
+	template <int _Components, typename _Ty>
+	void StoreVectors(const _Ty *src, uint64_t count) {
+		if constexpr (sizeof(_Ty) == sizeof(float) * _Components)
+			StoreScalars(reinterpret_cast<const float *>(src), count * _Components);
+		else {
+			for (uint64_t i = 0; i < count; i++) {
+				for (int c = 0; c < _Components; c++)
+					StoreFloat(static_cast<float>(src[i][c]));
+			}
+		}
+	}
+
+private:
+	std::vector<uint8_t> m_Data;
+};
+} //namespace behaviour_tree
@@ -17,14 +17,13 @@ public:
 	}
 
 public:
-	bool GetChildrens(std::vector<IBehaviourTreeNodeBehaviour *> &childrens) const final {
-		if (!m_Childrens.empty()) {
-			childrens.reserve(childrens.size() + m_Childrens.size());
-			for (auto &child : m_Childrens)
-				childrens.emplace_back(const_cast<IBehaviourTreeNodeBehaviour *>(*child));
-			return true;
-		}
-		return false;
+	~IBehaviourTreeCompositeNode() {
+		for (auto &child : m_Childrens)
+			UnlinkChild(this, *child);
+	}
+
+	NodeChildrens GetChildrens() const final {
+		return NodeChildrens(m_Childrens.data(), m_Childrens.size());
 	}
 
 	auto &GetChildrens() noexcept {
@@ -33,12 +32,27 @@ public:
 
 	void AddChild(Ref<IBehaviourTreeNodeBehaviour> child) {
 		m_Childrens.emplace_back(child);
+		LinkChild(this, *child);
+		NotifyStructureChanged();
 	}
 
 	void RemoveChild(Ref<IBehaviourTreeNodeBehaviour> child) {
 		auto iter = std::find(m_Childrens.begin(), m_Childrens.end(), child);
-		if (iter != m_Childrens.end())
+		if (iter != m_Childrens.end()) {
 			m_Childrens.erase(iter);
+			UnlinkChild(this, *child);
+			NotifyStructureChanged();
+		}
+	}
+
+	void SetChildrens(std::vector<Ref<IBehaviourTreeNodeBehaviour>> &&childrens) {
+		for (auto &child : m_Childrens)
+			UnlinkChild(this, *child);
+
+		m_Childrens = std::move(childrens);
+		for (auto &child : m_Childrens)
+			LinkChild(this, *child);
+		NotifyStructureChanged();
 	}
 
 private:
@@ -50,11 +64,25 @@ private:
 		return childrens;
 	}
 
+	// duplicate() sets the childrens of the original on the copy, they are linked by the tree loading the nodes
 	void GDSetChildrens(const Array &childrens) {
+		for (auto &child : m_Childrens)
+			UnlinkChild(this, *child);
+
 		m_Childrens.clear();
 		m_Childrens.reserve(childrens.size());
 		for (size_t i = 0; i < childrens.size(); i++)
 			m_Childrens.emplace_back(childrens[i]);
+		NotifyStructureChanged();
+	}
+
+protected:
+	void DetachChild(IBehaviourTreeNodeBehaviour *child) override {
+		auto iter = std::find(m_Childrens.begin(), m_Childrens.end(), child);
+		if (iter != m_Childrens.end()) {
+			m_Childrens.erase(iter);
+			NotifyStructureChanged();
+		}
 	}
 
 protected:
@@ -13,22 +13,33 @@ public:
 	}
 
 public:
-	bool GetChildrens(std::vector<IBehaviourTreeNodeBehaviour *> &childrens) const final {
-		if (m_Child.is_valid()) {
-			childrens.emplace_back(const_cast<IBehaviourTreeNodeBehaviour*>(*m_Child));
-			return true;
-		}
-		return false;
+	~IBehaviourTreeDecoratorNode() {
+		UnlinkChild(this, *m_Child);
+	}
+
+	NodeChildrens GetChildrens() const final {
+		return NodeChildrens(&m_Child, m_Child.is_valid() ? 1 : 0);
 	}
 
-	void SetChild(Ref<IBehaviourTreeNodeBehaviour> node) noexcept {
+	void SetChild(Ref<IBehaviourTreeNodeBehaviour> node) {
+		UnlinkChild(this, *m_Child);
 		m_Child = node;
+		LinkChild(this, *m_Child);
+		NotifyStructureChanged();
 	}
 
 	Ref<IBehaviourTreeNodeBehaviour> GetChild() const noexcept {
 		return m_Child;
 	}
 
+protected:
+	void DetachChild(IBehaviourTreeNodeBehaviour *child) override {
+		if (m_Child.ptr() == child) {
+			m_Child.unref();
+			NotifyStructureChanged();
+		}
+	}
+
 protected:
 	Ref<IBehaviourTreeNodeBehaviour> m_Child;
 };
@@ -82,22 +82,16 @@ void ClipboardBuffer::DoPaste(bool duplicate) {
 		}
 	};
 
-	std::vector<IBehaviourTreeNodeBehaviour *> childrens;
 	for (auto &[previous_node, new_node] : added_nodes) {
-		if (!previous_node->GetChildrens(childrens))
+		NodeChildrens childrens = previous_node->GetChildrens();
+		if (childrens.empty())
 			continue;
 
 		// Find if our previous node have a child that exists in added_nodes
 		for (auto &[nested_previous_node, nested_new_node] : added_nodes) {
-			for (IBehaviourTreeNodeBehaviour *child : childrens) {
-				if (child == nested_previous_node) {
-					connect_to_child(new_node, nested_new_node);
-					break;
-				}
-			}
+			if (childrens.Contains(nested_previous_node))
+				connect_to_child(new_node, nested_new_node);
 		}
-
-		childrens.clear();
 	}
 
 	undo_redo->add_do_method(m_Viewer, "_update_graph_layout", -1);
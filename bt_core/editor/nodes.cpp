@@ -153,10 +153,7 @@ void BehaviourTreeViewer::LinkGraphNode(GraphNode *gnode, int node_index, const
 		gnode->set_slot_color_left(0, Color(1.f, 1.f, 0.f, 0.65f));
 		gnode->set_slot_color_right(0, Color(1.f, 0.6f, 0.4f, 1.f));
 
-		std::vector<IBehaviourTreeNodeBehaviour *> childrens;
-		tree_node->GetChildrens(childrens);
-
-		for (IBehaviourTreeNodeBehaviour *child : childrens) {
+		for (IBehaviourTreeNodeBehaviour *child : tree_node->GetChildrens()) {
 			GraphNode *child_gnode = FindGraphNode(child);
 			m_Graph->connect_node(this_node_id, 0, child_gnode->get_name(), 0);
 		}
@@ -272,10 +269,12 @@ void BehaviourTreeViewer::SetNodePosition(int node_index, const Vector2 &positio
 		}
 	}
 
-	composite->GetChildrens().clear();
+	std::vector<Ref<IBehaviourTreeNodeBehaviour>> new_childrens;
+	new_childrens.reserve(sorted_childrens.size());
 	for (auto &data : sorted_childrens) {
-		composite->GetChildrens().emplace_back(data.Node);
+		new_childrens.emplace_back(data.Node);
 	}
+	composite->SetChildrens(std::move(new_childrens));
 }
 
 void BehaviourTreeViewer::SetAsRoot(int node_index) {
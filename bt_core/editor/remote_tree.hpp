@@ -38,7 +38,7 @@ public:
 		auto& nodes = m_Tree->GetNodes();
 		m_RemoteStates.resize(nodes.size());
 		for (int i = 0; i < m_RemoteStates.size(); i++) {
-			m_RemoteStates[i] = nodes[i]->GetState<int>();
+			m_RemoteStates[i] = static_cast<int>(m_Tree->GetNodeState(i));
 		}
 	}
 
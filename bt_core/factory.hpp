@@ -1,26 +1,103 @@
 #pragma once
 
+#include "node_behaviour.hpp"
+#include "core/object/class_db.h"
 #include "core/string/string_name.h"
+
+#include <deque>
 #include <map>
-#include <memory>
+#include <unordered_map>
 
 namespace behaviour_tree {
-class IBehaviourTreeNodeBehaviour;
+/*
+Registry of the native node types, a type registered here is registered in the ClassDB, listed in the editor
+and identified by a numeric type id in the serialized trees.
+
+Nodes of other modules are registered after the behaviour tree's types with:
 
+	BT_REGISTER_NODE(MyNode, "My Node", "Game/Actions", "Does something");
+*/
 class BehaviourTreeFactory {
 public:
 	using CreateNodeCallback = IBehaviourTreeNodeBehaviour *(*)();
 
-	static std::unique_ptr<IBehaviourTreeNodeBehaviour> CreateNode(const StringName &node_name) {
-		std::unique_ptr<IBehaviourTreeNodeBehaviour> node = nullptr;
-		auto factory = m_Factories.find(node_name);
+	struct NodeTypeInfo {
+		// hash of the class name, stable between builds, 0 is never a valid id
+		uint32_t TypeId;
+		StringName ClassName;
+		String Title;
+		String Category;
+		String Description;
+		CreateNodeCallback Create;
+	};
+
+	template <typename _Ty>
+	static uint32_t RegisterNode(const String &title, const String &category, const String &description) {
+		static_assert(std::is_base_of_v<IBehaviourTreeNodeBehaviour, _Ty>, "Nodes must derive from IBehaviourTreeNodeBehaviour");
+		const StringName class_name = _Ty::get_class_static();
+		const uint32_t type_id = MakeTypeId(class_name);
+		ERR_FAIL_COND_V_MSG(m_ByName.count(class_name), type_id, "Node type '" + String(class_name) + "' is already registered");
+		ERR_FAIL_COND_V_MSG(m_ById.count(type_id), 0, "Type id of '" + String(class_name) + "' collides with '" + String(m_ById[type_id]->ClassName) + "'");
+		ClassDB::register_class<_Ty>();
+
+		CreateNodeCallback create = []() -> IBehaviourTreeNodeBehaviour * {
+			return memnew(_Ty);
+		};
+		const NodeTypeInfo &info = m_Types.emplace_back(NodeTypeInfo{ type_id, class_name, title, category, description, create });
+		m_ByName.emplace(class_name, &info);
+		m_ById.emplace(type_id, &info);
+		return type_id;
+	}
+
+	static Ref<IBehaviourTreeNodeBehaviour> CreateNode(const StringName &class_name) {
+		const NodeTypeInfo *info = GetTypeInfo(class_name);
+		return info ? info->Create() : nullptr;
+	}
+	static Ref<IBehaviourTreeNodeBehaviour> CreateNode(uint32_t type_id) {
+		const NodeTypeInfo *info = GetTypeInfo(type_id);
+		return info ? info->Create() : nullptr;
+	}
 
-		if (factory != m_Factories.end())
-			node = std::unique_ptr<IBehaviourTreeNodeBehaviour>((factory->second)());
-		return node;
+	static const NodeTypeInfo *GetTypeInfo(const StringName &class_name) {
+		auto iter = m_ByName.find(class_name);
+		return iter != m_ByName.end() ? iter->second : nullptr;
+	}
+	static const NodeTypeInfo *GetTypeInfo(uint32_t type_id) {
+		auto iter = m_ById.find(type_id);
+		return iter != m_ById.end() ? iter->second : nullptr;
+	}
+
+	// 0 if the class isn't a registered native node
+	static uint32_t GetTypeId(const StringName &class_name) {
+		const NodeTypeInfo *info = GetTypeInfo(class_name);
+		return info ? info->TypeId : 0;
+	}
+
+	// In the order of registration
+	static const std::deque<NodeTypeInfo> &GetRegisteredTypes() noexcept {
+		return m_Types;
+	}
+
+	// Called when the module is uninitialized, before the StringNames are freed
+	static void Clear() {
+		m_ById.clear();
+		m_ByName.clear();
+		m_Types.clear();
 	}
 
 private:
-	static inline std::map<StringName, CreateNodeCallback> m_Factories;
+	static uint32_t MakeTypeId(const StringName &class_name) {
+		const uint32_t hash = String(class_name).hash();
+		return hash ? hash : 1;
+	}
+
+private:
+	// deque, the lookups point into it
+	static inline std::deque<NodeTypeInfo> m_Types;
+	static inline std::map<StringName, const NodeTypeInfo *> m_ByName;
+	static inline std::unordered_map<uint32_t, const NodeTypeInfo *> m_ById;
 };
 } //namespace behaviour_tree
+
+#define BT_REGISTER_NODE(m_class, m_title, m_category, m_description) \
+	::behaviour_tree::BehaviourTreeFactory::RegisterNode<m_class>(m_title, m_category, m_description)
@@ -0,0 +1,66 @@
+#include "file_mapping.hpp"
+#include "core/config/project_settings.h"
+#include "core/io/file_access_pack.h"
+
+#ifdef UNIX_ENABLED
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace behaviour_tree {
+FileMapping::~FileMapping() {
+	Close();
+}
+
+Error FileMapping::Open(const String &path) {
+	Close();
+
+#ifdef UNIX_ENABLED
+	// files in a pack are read through the pack's FileAccess
+	const bool is_packed = PackedData::get_singleton() && !PackedData::get_singleton()->is_disabled() && PackedData::get_singleton()->has_path(path);
+	if (!is_packed) {
+		const CharString native_path = ProjectSettings::get_singleton()->globalize_path(path).utf8();
+		const int fd = ::open(native_path.get_data(), O_RDONLY | O_CLOEXEC);
+		if (fd != -1) {
+			struct stat info;
+			if (fstat(fd, &info) == 0 && info.st_size > 0) {
+				void *address = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+				if (address != MAP_FAILED) {
+					m_Data = static_cast<const uint8_t *>(address);
+					m_Size = static_cast<uint64_t>(info.st_size);
+					m_IsMapped = true;
+				}
+			}
+			// the mapping stays valid without the descriptor
+			::close(fd);
+
+			if (m_IsMapped)
+				return Error::OK;
+		}
+	}
+#endif
+
+	Error err = Error::OK;
+	m_Buffer = FileAccess::get_file_as_array(path, &err);
+	if (err != Error::OK)
+		return err;
+
+	m_Data = m_Buffer.ptr();
+	m_Size = static_cast<uint64_t>(m_Buffer.size());
+	return Error::OK;
+}
+
+void FileMapping::Close() {
+#ifdef UNIX_ENABLED
+	if (m_IsMapped)
+		munmap(const_cast<uint8_t *>(m_Data), static_cast<size_t>(m_Size));
+#endif
+	m_Data = nullptr;
+	m_Size = 0;
+	m_IsMapped = false;
+	m_Buffer.clear();
+}
+
+} //namespace behaviour_tree
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "core/io/file_access.h"
+#include "core/templates/vector.h"
+
+namespace behaviour_tree {
+// Read-only view of a whole file, mapped in memory when the file is on disk and read in a single call otherwise
+class FileMapping {
+public:
+	FileMapping() = default;
+	~FileMapping();
+
+	FileMapping(const FileMapping &) = delete;
+	FileMapping &operator=(const FileMapping &) = delete;
+
+	Error Open(const String &path);
+	void Close();
+
+	const uint8_t *GetData() const noexcept {
+		return m_Data;
+	}
+	uint64_t GetSize() const noexcept {
+		return m_Size;
+	}
+	bool IsMapped() const noexcept {
+		return m_IsMapped;
+	}
+
+private:
+	const uint8_t *m_Data = nullptr;
+	uint64_t m_Size = 0;
+	bool m_IsMapped = false;
+
+	// holds the file when it couldn't be mapped
+	Vector<uint8_t> m_Buffer;
+};
+} //namespace behaviour_tree
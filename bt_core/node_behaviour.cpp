@@ -13,24 +13,87 @@ void IBehaviourTreeNodeBehaviour::_bind_methods() {
 	ADD_PROPERTY(PropertyInfo(Variant::DICTIONARY, "bt_data", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_STORAGE), "_set_bt_data", "_get_bt_data");
 
 	ClassDB::bind_method(D_METHOD("get_behaviour_tree"), &IBehaviourTreeNodeBehaviour::GetBehaviourTree);
+	ClassDB::bind_method(D_METHOD("get_btparent"), &IBehaviourTreeNodeBehaviour::GDGetParent);
 }
 
 void IBehaviourTreeNodeBehaviour::Abort() {
+	ResetSubtree(true, true);
+}
+
+void IBehaviourTreeNodeBehaviour::AbortChildrens() {
+	ResetSubtree(true, false);
+}
+
+void IBehaviourTreeNodeBehaviour::RewindChildrens() {
+	ResetSubtree(false, false);
+}
+
+void IBehaviourTreeNodeBehaviour::ResetSubtree(bool abort, bool include_self) {
+	BehaviourTree *tree = GetTree();
+	if (tree) {
+		// the running path may go through the aborted nodes
+		if (abort)
+			tree->ClearRunningPath();
+
+		// copies executed by the program have their subtree stored right after them
+		BehaviourTreeProgramState *state = tree->GetProgramState();
+		if (state && state->IsInstance(this, m_ProgramIndex)) {
+			const uint32_t begin = include_self ? m_ProgramIndex : m_ProgramIndex + 1;
+			const uint32_t end = state->GetProgram()->GetNodes()[m_ProgramIndex].SubtreeEnd;
+			if (abort)
+				state->AbortRange(begin, end);
+			else
+				state->RewindRange(begin, end);
+			return;
+		}
+	}
+
 	BehaviourTree::Traverse(
 			this,
-			[](IBehaviourTreeNodeBehaviour *node) {
-				if (node->GetState() != NodeState::Inactive)
+			[this, abort, include_self](IBehaviourTreeNodeBehaviour *node) {
+				if (node == this && !include_self)
+					return;
+
+				if (abort && node->GetState() != NodeState::Inactive)
 					node->OnExit();
 				node->Rewind();
 			});
 }
 
 Ref<BehaviourTree> IBehaviourTreeNodeBehaviour::GetBehaviourTree() const {
-	return m_Tree;
+	return GetTree();
+}
+
+BehaviourTree *IBehaviourTreeNodeBehaviour::GetTree() const {
+	if (m_OwnerTree)
+		return m_OwnerTree;
+	return Object::cast_to<BehaviourTree>(ObjectDB::get_instance(m_TreeId));
 }
 
 void IBehaviourTreeNodeBehaviour::SetBehaviourTree(Ref<BehaviourTree> tree) {
-	m_Tree = tree;
+	m_TreeId = tree.is_valid() ? tree->get_instance_id() : ObjectID();
+	m_OwnerTree = nullptr;
+}
+
+void IBehaviourTreeNodeBehaviour::LinkChildrens() {
+	for (IBehaviourTreeNodeBehaviour *child : GetChildrens())
+		LinkChild(this, child);
+}
+
+void IBehaviourTreeNodeBehaviour::SetOwnerTree(BehaviourTree *tree) {
+	m_TreeId = tree ? tree->get_instance_id() : ObjectID();
+	m_OwnerTree = tree;
+}
+
+void IBehaviourTreeNodeBehaviour::NotifyStructureChanged() {
+	m_Generation.fetch_add(1, std::memory_order_relaxed);
+	// the per agent copies aren't part of any program, relinking them doesn't make the other trees check their nodes
+	if (m_ProgramIndex == std::numeric_limits<uint32_t>::max())
+		DefinitionGeneration.fetch_add(1, std::memory_order_release);
+
+	BehaviourTree *tree = GetTree();
+	if (tree)
+		tree->InvalidateProgram();
 }
 
 void IBehaviourTreeNodeBehaviour::SetData(const Dictionary &data) {
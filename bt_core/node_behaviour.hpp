@@ -3,10 +3,16 @@
 #include "core/io/resource.h"
 #include "core/object/gdvirtual.gen.inc"
 #include "core/object/script_language.h"
+#include <atomic>
+#include <limits>
 #include <vector>
 
 namespace behaviour_tree {
 class BehaviourTree;
+class BehaviourTreeProgram;
+class NodeChildrens;
+struct CompiledNode;
+
 enum class NodeState : char {
 	Inactive = -1,
 	Running,
@@ -15,8 +21,18 @@ enum class NodeState : char {
 	Failure
 };
 
+// Threads a node can be executed from when its tree is ticked on a worker thread
+enum class NodeThreading : uint8_t {
+	Any,
+	// touches the scene, its effects are queued and applied on the main thread
+	Deferred,
+	MainThread
+};
+
 class IBehaviourTreeNodeBehaviour : public Resource {
 	GDCLASS(IBehaviourTreeNodeBehaviour, Resource);
+	friend class BehaviourTreeProgram;
+	friend class BehaviourTreeProgramState;
 
 public:
 	static void _bind_methods();
@@ -50,26 +66,150 @@ public:
 		m_State = NodeState::Inactive;
 	}
 
-	virtual bool GetChildrens(std::vector<IBehaviourTreeNodeBehaviour *> &childrens) const = 0;
+	virtual NodeChildrens GetChildrens() const = 0;
 	virtual void Initialize() {}
 
+	// Describes the node to the interpreter, nodes that leave it untouched are executed through their object
+	virtual void CompileNode(CompiledNode &compiled_node) const {}
+
+	// Only asked to nodes executed through their object, the interpreter's nodes can run on any thread
+	virtual NodeThreading GetThreading() const {
+		return NodeThreading::MainThread;
+	}
+
 	virtual void SerializeNode(Dictionary &out_data) const {}
 	virtual void DeserializeNode(const Dictionary &in_data) {}
+	// Resources DeserializeNode loads from the data, they are loaded ahead with those of the other nodes
+	virtual void GetDependencies(const Dictionary &in_data, std::vector<String> &out_paths) const {}
 
 	Ref<BehaviourTree> GetBehaviourTree() const;
 	void SetBehaviourTree(Ref<BehaviourTree> tree);
+	// Tree executing the node, without taking a reference. The per agent copies keep a pointer to the tree that
+	// owns them, the shared nodes look it up from its id
+	BehaviourTree *GetTree() const;
+
+	// Bumped by every edit of the node, programs compiled from an older generation of one of their nodes are rebuilt
+	uint32_t GetGeneration() const noexcept {
+		return m_Generation.load(std::memory_order_relaxed);
+	}
+	// Bumped with the generation of any shared node, the trees only check their nodes when it changed
+	static uint64_t GetDefinitionGeneration() noexcept {
+		return DefinitionGeneration.load(std::memory_order_acquire);
+	}
+
+	// Node holding this one as a child, kept up to date by the composite and decorator nodes
+	IBehaviourTreeNodeBehaviour *GetParent() const noexcept {
+		return m_Parent;
+	}
+	// Links back the childrens set from storage, which are not linked so copies can't take the original's childrens
+	void LinkChildrens();
 
 protected:
+	void NotifyStructureChanged();
+
+	// A node has a single parent, linking it to another one first removes it from the childrens of the previous one
+	static void LinkChild(IBehaviourTreeNodeBehaviour *parent, IBehaviourTreeNodeBehaviour *child) {
+		if (!child || child->m_Parent == parent)
+			return;
+		if (child->m_Parent)
+			child->m_Parent->DetachChild(child);
+		child->m_Parent = parent;
+	}
+	static void UnlinkChild(IBehaviourTreeNodeBehaviour *parent, IBehaviourTreeNodeBehaviour *child) noexcept {
+		if (child && child->m_Parent == parent)
+			child->m_Parent = nullptr;
+	}
+	// Removes the child without touching its link, called when it is linked to another node
+	virtual void DetachChild(IBehaviourTreeNodeBehaviour *child) {}
+
+	// Stops or resets the childrens and their subtrees, without touching this node
+	void AbortChildrens();
+	void RewindChildrens();
+
 	virtual void OnEnter() {}
 	virtual void OnExit() {}
 	virtual NodeState OnExecute() = 0;
 
 private:
+	void ResetSubtree(bool abort, bool include_self);
+	void SetOwnerTree(BehaviourTree *tree);
+
 	void SetData(const Dictionary &data);
 	Dictionary GetData() const;
 
+	Ref<IBehaviourTreeNodeBehaviour> GDGetParent() const {
+		return m_Parent;
+	}
+
 private:
 	NodeState m_State = NodeState::Inactive;
-	Ref<BehaviourTree> m_Tree = nullptr;
+	// nodes can be shared by many trees, they only keep a weak reference to the tree that owns them
+	ObjectID m_TreeId;
+	IBehaviourTreeNodeBehaviour *m_Parent = nullptr;
+	// set on the per agent copies, they are owned by the tree through its program state
+	BehaviourTree *m_OwnerTree = nullptr;
+	// index in the program of the tree, set on the per agent copies so their subtree can be reset as a range
+	uint32_t m_ProgramIndex = std::numeric_limits<uint32_t>::max();
+	std::atomic<uint32_t> m_Generation{ 0 };
+
+	static inline std::atomic<uint64_t> DefinitionGeneration{ 0 };
+};
+
+// Non owning view over the childrens of a node, the nodes keep their childrens as contiguous references
+class NodeChildrens {
+public:
+	class Iterator {
+	public:
+		explicit Iterator(const Ref<IBehaviourTreeNodeBehaviour> *child) noexcept :
+				m_Child(child) {}
+
+		IBehaviourTreeNodeBehaviour *operator*() const noexcept {
+			return m_Child->ptr();
+		}
+		Iterator &operator++() noexcept {
+			++m_Child;
+			return *this;
+		}
+		bool operator!=(const Iterator &other) const noexcept {
+			return m_Child != other.m_Child;
+		}
+
+	private:
+		const Ref<IBehaviourTreeNodeBehaviour> *m_Child;
+	};
+
+	NodeChildrens() = default;
+	NodeChildrens(const Ref<IBehaviourTreeNodeBehaviour> *begin, size_t size) noexcept :
+			m_Begin(begin), m_Size(size) {}
+
+	Iterator begin() const noexcept {
+		return Iterator(m_Begin);
+	}
+	Iterator end() const noexcept {
+		return Iterator(m_Begin + m_Size);
+	}
+
+	size_t size() const noexcept {
+		return m_Size;
+	}
+	bool empty() const noexcept {
+		return m_Size == 0;
+	}
+
+	IBehaviourTreeNodeBehaviour *operator[](size_t index) const noexcept {
+		return m_Begin[index].ptr();
+	}
+
+	bool Contains(const IBehaviourTreeNodeBehaviour *node) const noexcept {
+		for (size_t i = 0; i < m_Size; i++) {
+			if (m_Begin[i].ptr() == node)
+				return true;
+		}
+		return false;
+	}
+
+private:
+	const Ref<IBehaviourTreeNodeBehaviour> *m_Begin = nullptr;
+	size_t m_Size = 0;
 };
 } //namespace behaviour_tree
@@ -1,11 +1,17 @@
 #pragma once
 
 #include "../decorator_node.hpp"
+#include "../program.hpp"
 
 namespace behaviour_tree::nodes {
 class BehaviourTreeAlwaysFailureNode : public IBehaviourTreeDecoratorNode {
 	GDCLASS(BehaviourTreeAlwaysFailureNode, IBehaviourTreeDecoratorNode);
 
+public:
+	void CompileNode(CompiledNode &compiled_node) const override {
+		compiled_node.Op = OpCode::AlwaysFailure;
+	}
+
 protected:
 	NodeState OnExecute() override {
 		return m_Child->Execute() != NodeState::Running ? NodeState::Failure : NodeState::Running;
@@ -2,11 +2,17 @@
 #pragma once
 
 #include "../decorator_node.hpp"
+#include "../program.hpp"
 
 namespace behaviour_tree::nodes {
 class BehaviourTreeAlwaysSuccessNode : public IBehaviourTreeDecoratorNode {
 	GDCLASS(BehaviourTreeAlwaysSuccessNode, IBehaviourTreeDecoratorNode);
 
+public:
+	void CompileNode(CompiledNode &compiled_node) const override {
+		compiled_node.Op = OpCode::AlwaysSuccess;
+	}
+
 protected:
 	NodeState OnExecute() override {
 		return m_Child->Execute() != NodeState::Running ? NodeState::Success : NodeState::Running;
@@ -5,15 +5,24 @@
 namespace behaviour_tree::nodes {
 void BehaviourTreeRefNode::Rewind() {
 	IBehaviourTreeActionNode::Rewind();
-	m_Tree->Rewind();
+	if (m_Instance.is_valid())
+		m_Instance->Rewind();
 }
 
 void BehaviourTreeRefNode::OnEnter() {
-	m_Tree->Rewind();
+	if (m_Instance.is_null() && m_Tree.is_valid())
+		m_Instance = m_Tree->CreateInstance();
+	if (m_Instance.is_valid())
+		m_Instance->Rewind();
 }
 
 NodeState BehaviourTreeRefNode::OnExecute() {
-	m_Tree->ExecuteTree();
-	return m_Tree->GetRootNode()->GetState();
+	if (m_Instance.is_null())
+		return NodeState::Failure;
+
+	// the referenced tree runs on the time of its owner
+	BehaviourTree *tree = GetTree();
+	m_Instance->ExecuteTree(tree ? tree->GetTickDelta() : -1.0);
+	return m_Instance->GetRootState();
 }
 } //namespace behaviour_tree::nodes
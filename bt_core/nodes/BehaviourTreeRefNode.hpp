@@ -9,8 +9,8 @@ class BehaviourTreeRefNode : public IBehaviourTreeActionNode {
 
 public:
 	static void _bind_methods() {
-		ClassDB::bind_method(D_METHOD("_set_btree", "tree"), &BehaviourTreeRefNode::SetTree);
-		ClassDB::bind_method(D_METHOD("_get_btree"), &BehaviourTreeRefNode::GetTree);
+		ClassDB::bind_method(D_METHOD("_set_btree", "tree"), &BehaviourTreeRefNode::SetReferencedTree);
+		ClassDB::bind_method(D_METHOD("_get_btree"), &BehaviourTreeRefNode::GetReferencedTree);
 		ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "behaviour_tree", PROPERTY_HINT_RESOURCE_TYPE, "BehaviourTree", PROPERTY_USAGE_NO_EDITOR | PROPERTY_USAGE_STORAGE), "_set_btree", "_get_btree");
 	}
 
@@ -27,6 +27,12 @@ public:
 		IBehaviourTreeActionNode::DeserializeNode(in_data);
 	}
 
+	void GetDependencies(const Dictionary &in_data, std::vector<String> &out_paths) const override {
+		String path = in_data.get("behaviour_tree", "<null>");
+		if (path != "<null>")
+			out_paths.push_back(path);
+	}
+
 public:
 	void Rewind() override;
 
@@ -35,15 +41,18 @@ protected:
 	NodeState OnExecute() override;
 
 private:
-	void SetTree(const Ref<BehaviourTree> &tree) {
+	void SetReferencedTree(const Ref<BehaviourTree> &tree) {
 		m_Tree = tree;
+		m_Instance.unref();
 	}
 
-	Ref<BehaviourTree> GetTree() {
+	Ref<BehaviourTree> GetReferencedTree() {
 		return m_Tree;
 	}
 
 private:
 	Ref<BehaviourTree> m_Tree;
+	// state of the referenced tree for this node, created when the node is first entered
+	Ref<BehaviourTree> m_Instance;
 };
 } //namespace behaviour_tree::nodes
@@ -0,0 +1,34 @@
+#include "BlackboardConditionNode.hpp"
+#include "../tree.hpp"
+
+namespace behaviour_tree::nodes {
+bool BehaviourTreeBlackboardConditionNode::Check(const Variant &value) const {
+	switch (m_Condition) {
+		case ConditionType::IsSet:
+			return value.get_type() != Variant::NIL;
+		case ConditionType::IsNotSet:
+			return value.get_type() == Variant::NIL;
+		case ConditionType::Equal:
+			return Variant::evaluate(Variant::OP_EQUAL, value, m_Value);
+		case ConditionType::NotEqual:
+			return Variant::evaluate(Variant::OP_NOT_EQUAL, value, m_Value);
+		case ConditionType::Less:
+			return Variant::evaluate(Variant::OP_LESS, value, m_Value);
+		case ConditionType::LessEqual:
+			return Variant::evaluate(Variant::OP_LESS_EQUAL, value, m_Value);
+		case ConditionType::Greater:
+			return Variant::evaluate(Variant::OP_GREATER, value, m_Value);
+		case ConditionType::GreaterEqual:
+			return Variant::evaluate(Variant::OP_GREATER_EQUAL, value, m_Value);
+		default:
+			return false;
+	}
+}
+
+NodeState BehaviourTreeBlackboardConditionNode::OnExecute() {
+	BehaviourTree *tree = GetTree();
+	if (!tree || !Check(tree->GetBlackboard(m_Key)))
+		return NodeState::Failure;
+	return m_Child->Execute();
+}
+} //namespace behaviour_tree::nodes
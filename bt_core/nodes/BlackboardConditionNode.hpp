@@ -0,0 +1,114 @@
+#pragma once
+
+#include "../decorator_node.hpp"
+#include "../program.hpp"
+
+namespace behaviour_tree::nodes {
+class BehaviourTreeBlackboardConditionNode : public IBehaviourTreeDecoratorNode {
+	GDCLASS(BehaviourTreeBlackboardConditionNode, IBehaviourTreeDecoratorNode);
+
+public:
+	enum class ConditionType : uint8_t {
+		IsSet,
+		IsNotSet,
+		Equal,
+		NotEqual,
+		Less,
+		LessEqual,
+		Greater,
+		GreaterEqual
+	};
+
+	// What gets aborted once the observed key changes
+	enum AbortMode : uint8_t {
+		AbortNone,
+		// the running childrens, when the condition stops passing. While they run the condition isn't checked every tick
+		AbortSelf = 1 << 0,
+		// the running lower priority siblings, when the condition starts passing
+		AbortLowerPriority = 1 << 1,
+		AbortBoth = AbortSelf | AbortLowerPriority
+	};
+
+	static void _bind_methods() {
+		ClassDB::bind_method(D_METHOD("set_key", "key"), &BehaviourTreeBlackboardConditionNode::SetKey);
+		ClassDB::bind_method(D_METHOD("get_key"), &BehaviourTreeBlackboardConditionNode::GetKey);
+		ADD_PROPERTY(PropertyInfo(Variant::STRING_NAME, "key"), "set_key", "get_key");
+
+		ClassDB::bind_method(D_METHOD("set_condition", "condition"), &BehaviourTreeBlackboardConditionNode::SetCondition);
+		ClassDB::bind_method(D_METHOD("get_condition"), &BehaviourTreeBlackboardConditionNode::GetCondition);
+		ADD_PROPERTY(PropertyInfo(Variant::INT, "condition", PROPERTY_HINT_ENUM, "is set,is not set,==,!=,<,<=,>,>="), "set_condition", "get_condition");
+
+		ClassDB::bind_method(D_METHOD("set_value", "value"), &BehaviourTreeBlackboardConditionNode::SetValue);
+		ClassDB::bind_method(D_METHOD("get_value"), &BehaviourTreeBlackboardConditionNode::GetValue);
+		ADD_PROPERTY(PropertyInfo(Variant::NIL, "value", PROPERTY_HINT_NONE, "", PROPERTY_USAGE_DEFAULT | PROPERTY_USAGE_NIL_IS_VARIANT), "set_value", "get_value");
+
+		ClassDB::bind_method(D_METHOD("set_abort_mode", "mode"), &BehaviourTreeBlackboardConditionNode::SetAbortMode);
+		ClassDB::bind_method(D_METHOD("get_abort_mode"), &BehaviourTreeBlackboardConditionNode::GetAbortMode);
+		ADD_PROPERTY(PropertyInfo(Variant::INT, "abort_mode", PROPERTY_HINT_ENUM, "none,self,lower priority,both"), "set_abort_mode", "get_abort_mode");
+	}
+
+	void SerializeNode(Dictionary &out_data) const override {
+		out_data["key"] = m_Key;
+		out_data["condition"] = static_cast<int>(m_Condition);
+		out_data["value"] = m_Value;
+		out_data["abort_mode"] = static_cast<int>(m_AbortMode);
+		IBehaviourTreeDecoratorNode::SerializeNode(out_data);
+	}
+
+	void DeserializeNode(const Dictionary &in_data) {
+		IBehaviourTreeDecoratorNode::DeserializeNode(in_data);
+		m_Key = in_data["key"];
+		m_Condition = static_cast<ConditionType>(static_cast<int>(in_data["condition"]));
+		m_Value = in_data["value"];
+		m_AbortMode = static_cast<AbortMode>(static_cast<int>(in_data["abort_mode"]));
+	}
+
+	void CompileNode(CompiledNode &compiled_node) const override {
+		compiled_node.Op = OpCode::BlackboardCondition;
+		compiled_node.Args.BlackboardCondition.AbortMode = m_AbortMode;
+	}
+
+	const StringName &GetKey() const noexcept {
+		return m_Key;
+	}
+
+	bool Check(const Variant &value) const;
+
+protected:
+	NodeState OnExecute() override;
+
+private:
+	void SetKey(const StringName &key) {
+		m_Key = key;
+		NotifyStructureChanged();
+	}
+
+	void SetCondition(int condition) {
+		m_Condition = static_cast<ConditionType>(condition);
+	}
+	int GetCondition() const {
+		return static_cast<int>(m_Condition);
+	}
+
+	void SetValue(const Variant &value) {
+		m_Value = value;
+	}
+	Variant GetValue() const {
+		return m_Value;
+	}
+
+	void SetAbortMode(int mode) {
+		m_AbortMode = static_cast<AbortMode>(mode);
+		NotifyStructureChanged();
+	}
+	int GetAbortMode() const {
+		return static_cast<int>(m_AbortMode);
+	}
+
+private:
+	StringName m_Key;
+	ConditionType m_Condition = ConditionType::IsSet;
+	Variant m_Value;
+	AbortMode m_AbortMode = AbortNone;
+};
+} //namespace behaviour_tree::nodes
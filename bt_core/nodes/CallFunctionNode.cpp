@@ -1,31 +1,112 @@
 
 #include "CallFunctionNode.hpp"
 #include "../tree.hpp"
+#include "core/variant/variant_internal.h"
 
 namespace behaviour_tree::nodes {
 void BehaviourTreeCallFunctionNode::Initialize() {
-	Node *holder = Object::cast_to<Node>(GetBehaviourTree()->GetBlackboard("bt_target_node"));
+	Ref<BehaviourTree> tree = GetBehaviourTree();
+	Node *holder = Object::cast_to<Node>(tree->GetBlackboardSlot(tree->ResolveBlackboardSlot(SNAME("bt_target_node"))));
 	if (holder && !m_TargetPath.is_empty())
 		m_TargetNode = holder->get_node(m_TargetPath);
 	else
 		m_TargetNode = holder;
+
+	m_ReturnValueSlot = m_ReturnValueName.is_empty() ? InvalidSlot : tree->ResolveBlackboardSlot(m_ReturnValueName);
+	m_Args.ResolveBindings(*tree);
+	ResolveFunction();
+}
+
+void BehaviourTreeCallFunctionNode::ResolveFunction() {
+	m_Function = m_FunctionName;
+	m_Method = nullptr;
+	m_ScriptInstance = m_TargetNode ? m_TargetNode->get_script_instance() : nullptr;
+	m_CallPath = CallPath::Dynamic;
+
+	if (!m_TargetNode)
+		return;
+
+	// functions of the script are looked up first, like Object::callp does
+	if (m_ScriptInstance && m_ScriptInstance->has_method(m_Function)) {
+		m_CallPath = CallPath::Script;
+		return;
+	}
+
+	m_Method = ClassDB::get_method(m_TargetNode->get_class_name(), m_Function);
+	if (m_Method)
+		m_CallPath = CanValidateCall() ? CallPath::Validated : CallPath::Native;
+}
+
+bool BehaviourTreeCallFunctionNode::CanValidateCall() const {
+	// the type of the blackboard values can change between calls
+	if (m_Method->is_vararg() || m_Method->get_argument_count() != m_Args.GetCount() || m_Args.HasBindings())
+		return false;
+
+	for (int i = 0; i < m_Args.GetCount(); i++) {
+		const Variant::Type type = m_Method->get_argument_type(i);
+		// objects would need their class checked on each call
+		if (type == Variant::OBJECT || (type != Variant::NIL && type != m_Args.GetValue(i).get_type()))
+			return false;
+	}
+	return true;
+}
+
+// A function that can't be found fails before it is queued, like it would on the main thread
+bool BehaviourTreeCallFunctionNode::CanDeferCall() const {
+	if (!m_TargetNode)
+		return false;
+	if (m_IsDeffered || m_IsRPC || m_CallPath == CallPath::Script || m_Method)
+		return true;
+	return m_TargetNode->has_method(m_Function);
 }
 
 NodeState BehaviourTreeCallFunctionNode::OnExecute() {
-	std::vector<const Variant *> args;
-	args.reserve(m_Args.size());
+	// the tree is running on a worker thread, the function will be called on the main thread.
+	// Errors of the call itself are only reported there and the return value is written once it is applied
+	BehaviourTree *tree = GetTree();
+	if (tree && tree->IsDeferringCalls()) {
+		if (!CanDeferCall())
+			return NodeState::Failure;
+		tree->DeferCall([node = Ref(this)]() { node->CallFunction(); });
+		return NodeState::Success;
+	}
+	return CallFunction();
+}
+
+NodeState BehaviourTreeCallFunctionNode::CallFunction() {
+	BehaviourTree *tree = m_Args.HasBindings() || m_ReturnValueSlot != InvalidSlot ? GetTree() : nullptr;
+	const Variant **args = m_Args.GetPointers(tree);
+	const int arg_count = m_Args.GetCount();
 
-	for (size_t i = 0; i < m_Args.size(); i++)
-		args.emplace_back(&m_Args[i]);
+	if (m_CallPath == CallPath::Unresolved || (m_TargetNode && m_TargetNode->get_script_instance() != m_ScriptInstance))
+		ResolveFunction();
 
 	if (m_IsDeffered) {
-		MessageQueue::get_singleton()->push_callp(m_TargetNode, m_FunctionName, args.data(), m_Args.size());
+		MessageQueue::get_singleton()->push_callp(m_TargetNode, m_Function, args, arg_count);
 	} else {
 		if (!m_IsRPC) {
 			Callable::CallError err{};
-			Variant ret = m_TargetNode->callp(m_FunctionName, args.data(), m_Args.size(), err);
-			if (!m_ReturnValueName.is_empty())
-				GetBehaviourTree()->SetBlackboard(m_ReturnValueName, ret);
+			Variant ret;
+			switch (m_CallPath) {
+				case CallPath::Script:
+					ret = m_ScriptInstance->callp(m_Function, args, arg_count, err);
+					break;
+				case CallPath::Validated:
+					// the result is written in place, it must already hold the returned type
+					if (m_Method->has_return())
+						VariantInternal::initialize(&ret, m_Method->get_return_info().type);
+					m_Method->validated_call(m_TargetNode, args, &ret);
+					break;
+				case CallPath::Native:
+					ret = m_Method->call(m_TargetNode, args, arg_count, err);
+					break;
+				default:
+					ret = m_TargetNode->callp(m_Function, args, arg_count, err);
+					break;
+			}
+
+			if (m_ReturnValueSlot != InvalidSlot && tree)
+				tree->SetBlackboardSlot(m_ReturnValueSlot, ret);
 
 			if (err.error != Callable::CallError::CALL_OK) {
 #if TOOLS_ENABLED
@@ -35,7 +116,7 @@ NodeState BehaviourTreeCallFunctionNode::OnExecute() {
 #endif
 			}
 		} else {
-			m_TargetNode->rpcp(m_Args[0], m_FunctionName, args.data() + 1, args.size() - 1);
+			m_TargetNode->rpcp(*args[0], m_Function, args + 1, arg_count - 1);
 		}
 	}
 
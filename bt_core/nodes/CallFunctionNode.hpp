@@ -1,7 +1,9 @@
 #pragma once
 
 #include "../action_node.hpp"
+#include "NodeArguments.hpp"
 #include "scene/main/node.h"
+#include <limits>
 
 namespace behaviour_tree {
 class BehaviourTree;
@@ -35,15 +37,24 @@ public:
 		ClassDB::bind_method(D_METHOD("set_args", "args"), &BehaviourTreeCallFunctionNode::SetArgs);
 		ClassDB::bind_method(D_METHOD("get_args"), &BehaviourTreeCallFunctionNode::GetArgs);
 		ADD_PROPERTY(PropertyInfo(Variant::ARRAY, "arguments"), "set_args", "get_args");
+
+		ClassDB::bind_method(D_METHOD("set_bb_args", "bindings"), &BehaviourTreeCallFunctionNode::SetBlackboardArgs);
+		ClassDB::bind_method(D_METHOD("get_bb_args"), &BehaviourTreeCallFunctionNode::GetBlackboardArgs);
+		ADD_PROPERTY(PropertyInfo(Variant::DICTIONARY, "blackboard_arguments"), "set_bb_args", "get_bb_args");
 	}
 
 	void Initialize();
 
+	NodeThreading GetThreading() const override {
+		return NodeThreading::Deferred;
+	}
+
 	void SerializeNode(Dictionary &out_data) const override {
 		IBehaviourTreeActionNode::SerializeNode(out_data);
 
 		out_data["path"] = m_TargetPath;
-		out_data["args"] = m_Args;
+		out_data["args"] = m_Args.GetValues();
+		out_data["bb_args"] = m_Args.GetBindings();
 		out_data["function"] = m_FunctionName;
 		out_data["return"] = m_ReturnValueName;
 		out_data["deffered"] = m_IsDeffered;
@@ -52,7 +63,8 @@ public:
 
 	void DeserializeNode(const Dictionary &in_data) {
 		SetTargetNode(in_data["path"]);
-		m_Args = in_data["args"];
+		m_Args.SetValues(in_data["args"]);
+		m_Args.SetBindings(in_data["bb_args"]);
 		m_FunctionName = in_data["function"];
 		m_ReturnValueName = in_data["return"];
 		m_IsDeffered = in_data["deffered"];
@@ -64,9 +76,28 @@ public:
 protected:
 	NodeState OnExecute() override;
 
+private:
+	// How the function is called on the target, resolved once and again when the script of the target changes
+	enum class CallPath : uint8_t {
+		Unresolved,
+		// the script's function, looked up by the script instance
+		Script,
+		// native method whose arguments have the exact types, called without conversions
+		Validated,
+		Native,
+		// not known to the class, going through Object::callp
+		Dynamic
+	};
+
+	NodeState CallFunction();
+	void ResolveFunction();
+	bool CanValidateCall() const;
+	bool CanDeferCall() const;
+
 public:
 	void SetTargetNode(const NodePath &target_node) {
 		m_TargetPath = target_node;
+		m_CallPath = CallPath::Unresolved;
 	}
 	NodePath GetTargetNode() const {
 		return m_TargetPath;
@@ -74,6 +105,7 @@ public:
 
 	void SetCallbackFunction(const String &signal) {
 		m_FunctionName = signal;
+		m_CallPath = CallPath::Unresolved;
 	}
 	String GetCallbackFunction() const {
 		return m_FunctionName;
@@ -101,21 +133,39 @@ public:
 	}
 
 	void SetArgs(const Array &args) {
-		m_Args = args;
+		m_Args.SetValues(args);
+		m_CallPath = CallPath::Unresolved;
 	}
 	Array GetArgs() const {
-		return m_Args;
+		return m_Args.GetValues();
+	}
+
+	// Argument index to blackboard key, the argument is read from the blackboard on each call
+	void SetBlackboardArgs(const Dictionary &bindings) {
+		m_Args.SetBindings(bindings);
+		m_CallPath = CallPath::Unresolved;
+	}
+	Dictionary GetBlackboardArgs() const {
+		return m_Args.GetBindings();
 	}
 
 private:
 	Node *m_TargetNode = nullptr;
 	NodePath m_TargetPath;
 
-	Array m_Args;
+	NodeArguments m_Args;
 
 	String m_FunctionName;
 	String m_ReturnValueName;
 
+	StringName m_Function;
+	CallPath m_CallPath = CallPath::Unresolved;
+	MethodBind *m_Method = nullptr;
+	ScriptInstance *m_ScriptInstance = nullptr;
+
+	static constexpr uint32_t InvalidSlot = std::numeric_limits<uint32_t>::max();
+	uint32_t m_ReturnValueSlot = InvalidSlot;
+
 	bool m_IsDeffered = false;
 	bool m_IsRPC = false;
 };
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../decorator_node.hpp"
+#include "../program.hpp"
 
 namespace behaviour_tree::nodes {
 class BehaviourTreeConverterNode : public IBehaviourTreeDecoratorNode {
@@ -35,6 +36,13 @@ public:
 		IBehaviourTreeDecoratorNode::DeserializeNode(in_data);
 	}
 
+	void CompileNode(CompiledNode &compiled_node) const override {
+		compiled_node.Op = OpCode::Converter;
+		compiled_node.Args.Converter.Success = m_Success;
+		compiled_node.Args.Converter.Failure = m_Failure;
+		compiled_node.Args.Converter.Running = m_Running;
+	}
+
 protected:
 	NodeState OnExecute() final {
 		switch (m_Child->Execute()) {
@@ -56,6 +64,7 @@ public:
 			m_Failure = to;
 		else if constexpr (_From == NodeState::Running)
 			m_Running = to;
+		NotifyStructureChanged();
 	}
 
 	template <NodeState _From>
@@ -1,8 +1,95 @@
 #include "CustomNodes.hpp"
+#include "core/core_string_names.h"
 
 namespace behaviour_tree::nodes {
 using namespace behaviour_tree;
 
+void CustomNodeHooks::Refresh(const ScriptInstance *instance, bool has_extension, Cache &cache, bool reload) {
+	Ref<Script> script = instance ? instance->get_script() : Ref<Script>();
+	// taken first, a change while resolving makes the node refresh again
+	cache.Generation = Generation.load(std::memory_order_acquire);
+	cache.Instance = instance;
+	cache.Script = script.is_valid() ? script->get_instance_id() : ObjectID();
+	// the virtuals of extensions are resolved by the engine
+	cache.Hooks = has_extension ? CUSTOM_NODE_HOOK_ALL : ResolveHooks(script, reload);
+}
+
+void CustomNodeHooks::Revalidate(const ScriptInstance *instance, bool has_extension, Cache &cache) {
+#ifdef DEBUG_ENABLED
+	Refresh(instance, has_extension, cache, true);
+#else
+	Ref<Script> script = instance ? instance->get_script() : Ref<Script>();
+	const ObjectID script_id = script.is_valid() ? script->get_instance_id() : ObjectID();
+	if (cache.Instance != instance || cache.Script != script_id || cache.Generation != Generation.load(std::memory_order_acquire))
+		Refresh(instance, has_extension, cache, false);
+#endif
+}
+
+uint32_t CustomNodeHooks::ResolveHooks(const Ref<Script> &script, bool reload) {
+	if (script.is_null())
+		return 0;
+
+	const ObjectID script_id = script->get_instance_id();
+	MutexLock lock(Lock);
+
+	if (!Singleton)
+		Singleton = memnew(CustomNodeHooks);
+
+	auto iter = Singleton->m_Hooks.find(uint64_t(script_id));
+	if (iter != Singleton->m_Hooks.end() && !reload)
+		return iter->second;
+
+	static const std::pair<CustomNodeHook, const char *> hooks[] = {
+		{ CUSTOM_NODE_HOOK_INITIALIZE, "_on_btnode_initialize" },
+		{ CUSTOM_NODE_HOOK_REWIND, "_on_btnode_rewind" },
+		{ CUSTOM_NODE_HOOK_ENTER, "_on_btnode_enter" },
+		{ CUSTOM_NODE_HOOK_EXECUTE, "_on_btnode_execute" },
+		{ CUSTOM_NODE_HOOK_EXIT, "_on_btnode_exit" },
+		{ CUSTOM_NODE_HOOK_SERIALIZE, "_on_btnode_serialize" },
+		{ CUSTOM_NODE_HOOK_DESERIALIZE, "_on_btnode_deserialize" },
+	};
+
+	// methods of the base scripts count too
+	uint32_t mask = 0;
+	for (Ref<Script> cur_script = script; cur_script.is_valid(); cur_script = cur_script->get_base_script()) {
+		for (const auto &[hook, name] : hooks) {
+			if (cur_script->has_method(name))
+				mask |= hook;
+		}
+	}
+
+	// a change to the script or any of its bases drops the whole table, scripts rarely change at runtime
+	for (Ref<Script> cur_script = script; cur_script.is_valid(); cur_script = cur_script->get_base_script()) {
+		Callable on_changed = callable_mp(Singleton, &CustomNodeHooks::OnScriptChanged);
+		if (!cur_script->is_connected(CoreStringNames::get_singleton()->changed, on_changed))
+			cur_script->connect(CoreStringNames::get_singleton()->changed, on_changed);
+	}
+
+	if (iter == Singleton->m_Hooks.end())
+		Singleton->m_Hooks.emplace(uint64_t(script_id), mask);
+	else if (iter->second != mask) {
+		// reloaded without a change notification
+		iter->second = mask;
+		Generation.fetch_add(1, std::memory_order_release);
+	}
+	return mask;
+}
+
+void CustomNodeHooks::OnScriptChanged() {
+	MutexLock lock(Lock);
+	m_Hooks.clear();
+	Generation.fetch_add(1, std::memory_order_release);
+}
+
+void CustomNodeHooks::Clear() {
+	MutexLock lock(Lock);
+	if (Singleton) {
+		memdelete(Singleton);
+		Singleton = nullptr;
+	}
+	Generation.fetch_add(1, std::memory_order_release);
+}
+
 void BehaviourTreeCustomActionNode::_bind_methods() {
 	GDVIRTUAL_BIND(_on_btnode_rewind);
 	GDVIRTUAL_BIND(_on_btnode_initialize);
@@ -17,11 +104,14 @@ void BehaviourTreeCustomActionNode::_bind_methods() {
 
 void BehaviourTreeCustomActionNode::Rewind() {
 	IBehaviourTreeActionNode::Rewind();
-	GDVIRTUAL_CALL(_on_btnode_rewind);
+	if (HasHook(CUSTOM_NODE_HOOK_REWIND))
+		GDVIRTUAL_CALL(_on_btnode_rewind);
 }
 
 void BehaviourTreeCustomActionNode::Initialize() {
-	GDVIRTUAL_CALL(_on_btnode_initialize);
+	CustomNodeHooks::Revalidate(get_script_instance(), _get_extension() != nullptr, m_Hooks);
+	if (HasHook(CUSTOM_NODE_HOOK_INITIALIZE))
+		GDVIRTUAL_CALL(_on_btnode_initialize);
 }
 
 void BehaviourTreeCustomActionNode::SerializeNode(Dictionary &out_data) const {
@@ -36,7 +126,8 @@ void BehaviourTreeCustomActionNode::SerializeNode(Dictionary &out_data) const {
 			out_data[prop.name] = get(prop.name);
 	}
 
-	GDVIRTUAL_CALL(_on_btnode_serialize, out_data, out_data);
+	if (HasHook(CUSTOM_NODE_HOOK_SERIALIZE))
+		GDVIRTUAL_CALL(_on_btnode_serialize, out_data, out_data);
 }
 
 void BehaviourTreeCustomActionNode::DeserializeNode(const Dictionary &in_data) {
@@ -52,21 +143,25 @@ void BehaviourTreeCustomActionNode::DeserializeNode(const Dictionary &in_data) {
 			set(prop.name, in_data[prop.name]);
 	}
 
-	GDVIRTUAL_CALL(_on_btnode_deserialize, in_data);
+	if (HasHook(CUSTOM_NODE_HOOK_DESERIALIZE))
+		GDVIRTUAL_CALL(_on_btnode_deserialize, in_data);
 }
 
 void BehaviourTreeCustomActionNode::OnEnter() {
-	GDVIRTUAL_CALL(_on_btnode_enter);
+	if (HasHook(CUSTOM_NODE_HOOK_ENTER))
+		GDVIRTUAL_CALL(_on_btnode_enter);
 }
 
 NodeState BehaviourTreeCustomActionNode::OnExecute() {
 	BehaviourTree::BehaviourTreeNodeState ret = BehaviourTree::BEHAVIOUR_TREE_NODE_INACTIVE;
-	GDVIRTUAL_CALL(_on_btnode_execute, ret);
+	if (HasHook(CUSTOM_NODE_HOOK_EXECUTE))
+		GDVIRTUAL_CALL(_on_btnode_execute, ret);
 	return static_cast<NodeState>(ret);
 }
 
 void BehaviourTreeCustomActionNode::OnExit() {
-	GDVIRTUAL_CALL(_on_btnode_exit);
+	if (HasHook(CUSTOM_NODE_HOOK_EXIT))
+		GDVIRTUAL_CALL(_on_btnode_exit);
 }
 
 void BehaviourTreeCustomCompositeNode::_bind_methods() {
@@ -86,11 +181,14 @@ void BehaviourTreeCustomCompositeNode::_bind_methods() {
 
 void BehaviourTreeCustomCompositeNode::Rewind() {
 	IBehaviourTreeCompositeNode::Rewind();
-	GDVIRTUAL_CALL(_on_btnode_rewind);
+	if (HasHook(CUSTOM_NODE_HOOK_REWIND))
+		GDVIRTUAL_CALL(_on_btnode_rewind);
 }
 
 void BehaviourTreeCustomCompositeNode::Initialize() {
-	GDVIRTUAL_CALL(_on_btnode_initialize);
+	CustomNodeHooks::Revalidate(get_script_instance(), _get_extension() != nullptr, m_Hooks);
+	if (HasHook(CUSTOM_NODE_HOOK_INITIALIZE))
+		GDVIRTUAL_CALL(_on_btnode_initialize);
 }
 
 void BehaviourTreeCustomCompositeNode::SerializeNode(Dictionary &out_data) const {
@@ -105,7 +203,8 @@ void BehaviourTreeCustomCompositeNode::SerializeNode(Dictionary &out_data) const
 			out_data[prop.name] = get(prop.name);
 	}
 
-	GDVIRTUAL_CALL(_on_btnode_serialize, out_data, out_data);
+	if (HasHook(CUSTOM_NODE_HOOK_SERIALIZE))
+		GDVIRTUAL_CALL(_on_btnode_serialize, out_data, out_data);
 }
 
 void BehaviourTreeCustomCompositeNode::DeserializeNode(const Dictionary &in_data) {
@@ -120,21 +219,25 @@ void BehaviourTreeCustomCompositeNode::DeserializeNode(const Dictionary &in_data
 			set(prop.name, in_data[prop.name]);
 	}
 
-	GDVIRTUAL_CALL(_on_btnode_deserialize, in_data);
+	if (HasHook(CUSTOM_NODE_HOOK_DESERIALIZE))
+		GDVIRTUAL_CALL(_on_btnode_deserialize, in_data);
 }
 
 void BehaviourTreeCustomCompositeNode::OnEnter() {
-	GDVIRTUAL_CALL(_on_btnode_enter);
+	if (HasHook(CUSTOM_NODE_HOOK_ENTER))
+		GDVIRTUAL_CALL(_on_btnode_enter);
 }
 
 NodeState BehaviourTreeCustomCompositeNode::OnExecute() {
 	BehaviourTree::BehaviourTreeNodeState ret = BehaviourTree::BEHAVIOUR_TREE_NODE_INACTIVE;
-	GDVIRTUAL_CALL(_on_btnode_execute, ret);
+	if (HasHook(CUSTOM_NODE_HOOK_EXECUTE))
+		GDVIRTUAL_CALL(_on_btnode_execute, ret);
 	return static_cast<NodeState>(ret);
 }
 
 void BehaviourTreeCustomCompositeNode::OnExit() {
-	GDVIRTUAL_CALL(_on_btnode_exit);
+	if (HasHook(CUSTOM_NODE_HOOK_EXIT))
+		GDVIRTUAL_CALL(_on_btnode_exit);
 }
 
 Array BehaviourTreeCustomCompositeNode::GDGetChildrens() {
@@ -146,10 +249,11 @@ Array BehaviourTreeCustomCompositeNode::GDGetChildrens() {
 }
 
 void BehaviourTreeCustomCompositeNode::GDSetChildrens(const Array &childrens) {
-	m_Childrens.clear();
-	m_Childrens.reserve(childrens.size());
+	std::vector<Ref<IBehaviourTreeNodeBehaviour>> new_childrens;
+	new_childrens.reserve(childrens.size());
 	for (size_t i = 0; i < childrens.size(); i++)
-		m_Childrens.emplace_back(childrens[i]);
+		new_childrens.emplace_back(childrens[i]);
+	SetChildrens(std::move(new_childrens));
 }
 
 void BehaviourTreeCustomDecoratorNode::_bind_methods() {
@@ -166,11 +270,14 @@ void BehaviourTreeCustomDecoratorNode::_bind_methods() {
 
 void BehaviourTreeCustomDecoratorNode::Rewind() {
 	IBehaviourTreeDecoratorNode::Rewind();
-	GDVIRTUAL_CALL(_on_btnode_rewind);
+	if (HasHook(CUSTOM_NODE_HOOK_REWIND))
+		GDVIRTUAL_CALL(_on_btnode_rewind);
 }
 
 void BehaviourTreeCustomDecoratorNode::Initialize() {
-	GDVIRTUAL_CALL(_on_btnode_initialize);
+	CustomNodeHooks::Revalidate(get_script_instance(), _get_extension() != nullptr, m_Hooks);
+	if (HasHook(CUSTOM_NODE_HOOK_INITIALIZE))
+		GDVIRTUAL_CALL(_on_btnode_initialize);
 }
 
 void BehaviourTreeCustomDecoratorNode::SerializeNode(Dictionary &out_data) const {
@@ -185,7 +292,8 @@ void BehaviourTreeCustomDecoratorNode::SerializeNode(Dictionary &out_data) const
 			out_data[prop.name] = get(prop.name);
 	}
 
-	GDVIRTUAL_CALL(_on_btnode_serialize, out_data, out_data);
+	if (HasHook(CUSTOM_NODE_HOOK_SERIALIZE))
+		GDVIRTUAL_CALL(_on_btnode_serialize, out_data, out_data);
 }
 
 void BehaviourTreeCustomDecoratorNode::DeserializeNode(const Dictionary &in_data) {
@@ -200,20 +308,24 @@ void BehaviourTreeCustomDecoratorNode::DeserializeNode(const Dictionary &in_data
 			set(prop.name, in_data[prop.name]);
 	}
 
-	GDVIRTUAL_CALL(_on_btnode_deserialize, in_data);
+	if (HasHook(CUSTOM_NODE_HOOK_DESERIALIZE))
+		GDVIRTUAL_CALL(_on_btnode_deserialize, in_data);
 }
 
 void BehaviourTreeCustomDecoratorNode::OnEnter() {
-	GDVIRTUAL_CALL(_on_btnode_enter);
+	if (HasHook(CUSTOM_NODE_HOOK_ENTER))
+		GDVIRTUAL_CALL(_on_btnode_enter);
 }
 
 NodeState BehaviourTreeCustomDecoratorNode::OnExecute() {
 	BehaviourTree::BehaviourTreeNodeState ret = BehaviourTree::BEHAVIOUR_TREE_NODE_INACTIVE;
-	GDVIRTUAL_CALL(_on_btnode_execute, ret);
+	if (HasHook(CUSTOM_NODE_HOOK_EXECUTE))
+		GDVIRTUAL_CALL(_on_btnode_execute, ret);
 	return static_cast<NodeState>(ret);
 }
 
 void BehaviourTreeCustomDecoratorNode::OnExit() {
-	GDVIRTUAL_CALL(_on_btnode_exit);
+	if (HasHook(CUSTOM_NODE_HOOK_EXIT))
+		GDVIRTUAL_CALL(_on_btnode_exit);
 }
 } //namespace behaviour_tree::nodes
@@ -5,7 +5,59 @@
 #include "../composite_node.hpp"
 #include "../decorator_node.hpp"
 
+#include <atomic>
+#include <unordered_map>
+
 namespace behaviour_tree::nodes {
+// Virtuals of the custom nodes, the calls to the ones the script doesn't implement are skipped
+enum CustomNodeHook : uint32_t {
+	CUSTOM_NODE_HOOK_INITIALIZE = 1 << 0,
+	CUSTOM_NODE_HOOK_REWIND = 1 << 1,
+	CUSTOM_NODE_HOOK_ENTER = 1 << 2,
+	CUSTOM_NODE_HOOK_EXECUTE = 1 << 3,
+	CUSTOM_NODE_HOOK_EXIT = 1 << 4,
+	CUSTOM_NODE_HOOK_SERIALIZE = 1 << 5,
+	CUSTOM_NODE_HOOK_DESERIALIZE = 1 << 6,
+	CUSTOM_NODE_HOOK_ALL = (1 << 7) - 1,
+};
+
+// Bitmask of the hooks implemented by each script, computed once per script and dropped when it changes
+class CustomNodeHooks : public Object {
+public:
+	// Per node, refreshed when the node's script instance or any of the scripts changed
+	struct Cache {
+		const ScriptInstance *Instance = nullptr;
+		ObjectID Script;
+		uint32_t Generation = 0;
+		uint32_t Hooks = 0;
+	};
+
+	static uint32_t GetHooks(const ScriptInstance *instance, bool has_extension, Cache &cache) {
+		if (cache.Instance != instance || cache.Generation != Generation.load(std::memory_order_acquire))
+			Refresh(instance, has_extension, cache, false);
+		return cache.Hooks;
+	}
+
+	// Called when the node is initialized. Checks the script itself, a new instance can take the address of the
+	// previous one, and in debug builds resolves the hooks again since a hot reload doesn't always emit 'changed'
+	static void Revalidate(const ScriptInstance *instance, bool has_extension, Cache &cache);
+
+	static void Clear();
+
+private:
+	static void Refresh(const ScriptInstance *instance, bool has_extension, Cache &cache, bool reload);
+	// When 'reload' is set the methods of the script are looked up again, the other nodes refresh if they changed
+	static uint32_t ResolveHooks(const Ref<Script> &script, bool reload);
+	void OnScriptChanged();
+
+private:
+	static inline CustomNodeHooks *Singleton = nullptr;
+	static inline Mutex Lock;
+	static inline std::atomic<uint32_t> Generation = 1;
+
+	std::unordered_map<uint64_t, uint32_t> m_Hooks;
+};
+
 class BehaviourTreeCustomActionNode : public IBehaviourTreeActionNode {
 	GDCLASS(BehaviourTreeCustomActionNode, IBehaviourTreeActionNode);
 
@@ -34,6 +86,13 @@ protected:
 	void OnEnter() override;
 	NodeState OnExecute() override;
 	void OnExit() override;
+
+private:
+	bool HasHook(CustomNodeHook hook) const {
+		return CustomNodeHooks::GetHooks(get_script_instance(), _get_extension() != nullptr, m_Hooks) & hook;
+	}
+
+	mutable CustomNodeHooks::Cache m_Hooks;
 };
 
 class BehaviourTreeCustomCompositeNode : public IBehaviourTreeCompositeNode {
@@ -66,8 +125,15 @@ protected:
 	void OnExit() override;
 
 private:
+	bool HasHook(CustomNodeHook hook) const {
+		return CustomNodeHooks::GetHooks(get_script_instance(), _get_extension() != nullptr, m_Hooks) & hook;
+	}
+
 	Array GDGetChildrens();
 	void GDSetChildrens(const Array &childrens);
+
+private:
+	mutable CustomNodeHooks::Cache m_Hooks;
 };
 
 class BehaviourTreeCustomDecoratorNode : public IBehaviourTreeDecoratorNode {
@@ -98,5 +164,12 @@ protected:
 	void OnEnter() override;
 	NodeState OnExecute() override;
 	void OnExit() override;
+
+private:
+	bool HasHook(CustomNodeHook hook) const {
+		return CustomNodeHooks::GetHooks(get_script_instance(), _get_extension() != nullptr, m_Hooks) & hook;
+	}
+
+	mutable CustomNodeHooks::Cache m_Hooks;
 };
 } //namespace behaviour_tree::nodes
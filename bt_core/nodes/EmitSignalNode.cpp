@@ -4,21 +4,32 @@
 
 namespace behaviour_tree::nodes {
 void BehaviourTreeEmitSignalNode::Initialize() {
-	Node *holder = Object::cast_to<Node>(GetBehaviourTree()->GetBlackboard("bt_target_node"));
+	Ref<BehaviourTree> tree = GetBehaviourTree();
+	Node *holder = Object::cast_to<Node>(tree->GetBlackboardSlot(tree->ResolveBlackboardSlot(SNAME("bt_target_node"))));
 	if (holder && !m_TargetPath.is_empty())
 		m_TargetNode = holder->get_node(m_TargetPath);
 	else
 		m_TargetNode = holder;
+
+	m_Args.ResolveBindings(*tree);
 }
 
 NodeState BehaviourTreeEmitSignalNode::OnExecute() {
-	std::vector<const Variant *> args;
-	args.reserve(m_Args.size());
-
-	for (size_t i = 0; i < m_Args.size(); i++)
-		args.emplace_back(&m_Args[i]);
+	// the tree is running on a worker thread, the signal will be emitted on the main thread.
+	// A signal that doesn't exist fails before it is queued, like it would on the main thread
+	BehaviourTree *tree = GetTree();
+	if (tree && tree->IsDeferringCalls()) {
+		if (!m_TargetNode || !m_TargetNode->has_signal(m_Signal))
+			return NodeState::Failure;
+		tree->DeferCall([node = Ref(this)]() { node->EmitSignal(); });
+		return NodeState::Success;
+	}
+	return EmitSignal();
+}
 
-	if (m_TargetNode->emit_signalp(m_SignalName, args.data(), m_Args.size()) != Error::OK) {
+NodeState BehaviourTreeEmitSignalNode::EmitSignal() {
+	const Variant **args = m_Args.GetPointers(m_Args.HasBindings() ? GetTree() : nullptr);
+	if (m_TargetNode->emit_signalp(m_Signal, args, m_Args.GetCount()) != Error::OK) {
 #if TOOLS_ENABLED
 		ERR_FAIL_V_MSG(NodeState::Failure, "Failed to emit signal " + m_SignalName + " of node " + m_TargetNode->get_path());
 #else
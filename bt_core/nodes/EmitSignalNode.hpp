@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../action_node.hpp"
+#include "NodeArguments.hpp"
 
 namespace behaviour_tree {
 class BehaviourTree;
@@ -23,6 +24,10 @@ public:
 		ClassDB::bind_method(D_METHOD("get_args"), &BehaviourTreeEmitSignalNode::GetArgs);
 		ADD_PROPERTY(PropertyInfo(Variant::ARRAY, "arguments"), "set_args", "get_args");
 
+		ClassDB::bind_method(D_METHOD("set_bb_args", "bindings"), &BehaviourTreeEmitSignalNode::SetBlackboardArgs);
+		ClassDB::bind_method(D_METHOD("get_bb_args"), &BehaviourTreeEmitSignalNode::GetBlackboardArgs);
+		ADD_PROPERTY(PropertyInfo(Variant::DICTIONARY, "blackboard_arguments"), "set_bb_args", "get_bb_args");
+
 #if TOOLS_ENABLED
 		ADD_SIGNAL(MethodInfo("_btree_signal_node_path_changed"));
 #endif
@@ -30,18 +35,24 @@ public:
 
 	void Initialize() override;
 
+	NodeThreading GetThreading() const override {
+		return NodeThreading::Deferred;
+	}
+
 	void SerializeNode(Dictionary &out_data) const override {
 		IBehaviourTreeActionNode::SerializeNode(out_data);
 
 		out_data["path"] = m_TargetPath;
-		out_data["args"] = m_Args;
+		out_data["args"] = m_Args.GetValues();
+		out_data["bb_args"] = m_Args.GetBindings();
 		out_data["singal"] = m_SignalName;
 	}
 
 	void DeserializeNode(const Dictionary &in_data) {
 		SetTargetNode(in_data["path"]);
-		m_Args = in_data["args"];
-		m_SignalName = in_data["siganl"];
+		m_Args.SetValues(in_data["args"]);
+		m_Args.SetBindings(in_data["bb_args"]);
+		SetCallbackSignal(in_data["siganl"]);
 
 		IBehaviourTreeActionNode::DeserializeNode(in_data);
 	}
@@ -49,6 +60,9 @@ public:
 protected:
 	NodeState OnExecute() override;
 
+private:
+	NodeState EmitSignal();
+
 public:
 	void SetTargetNode(NodePath target_node) {
 		m_TargetPath = target_node;
@@ -62,23 +76,33 @@ public:
 
 	void SetCallbackSignal(const String &signal) {
 		m_SignalName = signal;
+		m_Signal = m_SignalName;
 	}
 	String GetCallbackSignal() const {
 		return m_SignalName;
 	}
 
 	void SetArgs(const Array &args) {
-		m_Args = args;
+		m_Args.SetValues(args);
 	}
 	Array GetArgs() const {
-		return m_Args;
+		return m_Args.GetValues();
+	}
+
+	// Argument index to blackboard key, the argument is read from the blackboard on each emission
+	void SetBlackboardArgs(const Dictionary &bindings) {
+		m_Args.SetBindings(bindings);
+	}
+	Dictionary GetBlackboardArgs() const {
+		return m_Args.GetBindings();
 	}
 
 private:
 	Node *m_TargetNode = nullptr;
 	NodePath m_TargetPath;
 
-	Array m_Args;
+	NodeArguments m_Args;
 	String m_SignalName;
+	StringName m_Signal;
 };
 } //namespace behaviour_tree::nodes
@@ -1,11 +1,17 @@
 #pragma once
 
 #include "../composite_node.hpp"
+#include "../program.hpp"
 
 namespace behaviour_tree::nodes {
 class BehaviourTreeFallbackNode : public IBehaviourTreeCompositeNode {
 	GDCLASS(BehaviourTreeFallbackNode, IBehaviourTreeCompositeNode);
 
+public:
+	void CompileNode(CompiledNode &compiled_node) const override {
+		compiled_node.Op = OpCode::Fallback;
+	}
+
 protected:
 	NodeState OnExecute() override {
 		for (size_t i = 0; i < m_Childrens.size(); i++) {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../decorator_node.hpp"
+#include "../program.hpp"
 
 namespace behaviour_tree::nodes {
 class BehaviourTreeLoopNode : public IBehaviourTreeDecoratorNode {
@@ -29,6 +30,12 @@ public:
 		IBehaviourTreeDecoratorNode::DeserializeNode(in_data);
 	}
 
+	void CompileNode(CompiledNode &compiled_node) const override {
+		compiled_node.Op = OpCode::Loop;
+		compiled_node.Args.Loop.Count = m_LoopCount;
+		compiled_node.Args.Loop.ExitOnFailure = m_ExitOnFailure;
+	}
+
 protected:
 	void OnEnter() override {
 		m_CurLoopCount = m_LoopCount;
@@ -45,7 +52,7 @@ protected:
 					[[fallthrough]];
 
 				case NodeState::Success:
-					RestartChildrens();
+					RewindChildrens();
 					if (m_CurLoopCount != -1)
 						--m_CurLoopCount;
 					break;
@@ -57,23 +64,18 @@ protected:
 	}
 
 private:
-	void RestartChildrens() {
-		BehaviourTree::Traverse(this,
-				[](IBehaviourTreeNodeBehaviour *cur_node) {
-					cur_node->Rewind();
-				});
-	}
-
-	void SetLoopCount(int count = -1) noexcept {
+	void SetLoopCount(int count = -1) {
 		m_LoopCount = count;
+		NotifyStructureChanged();
 	}
 
 	int GetLoopCount() noexcept {
 		return m_LoopCount;
 	}
 
-	void SetExitOnFailure(bool state) noexcept {
+	void SetExitOnFailure(bool state) {
 		m_ExitOnFailure = state;
+		NotifyStructureChanged();
 	}
 
 	bool GetExitOnFailure() noexcept {
@@ -0,0 +1,64 @@
+#include "NodeArguments.hpp"
+#include "../tree.hpp"
+#include <limits>
+
+namespace behaviour_tree::nodes {
+void NodeArguments::SetValues(const Array &values) {
+	// arrays are shared, the table would dangle if the caller resized its array
+	m_Values = values.duplicate();
+	BuildPointers();
+}
+
+void NodeArguments::SetBindings(const Dictionary &bindings) {
+	m_Bindings.clear();
+	m_ResolvedTree = nullptr;
+
+	Array keys = bindings.keys();
+	for (int i = 0; i < keys.size(); i++)
+		m_Bindings.push_back({ keys[i], bindings[keys[i]], std::numeric_limits<uint32_t>::max() });
+	BuildPointers();
+}
+
+Dictionary NodeArguments::GetBindings() const {
+	Dictionary bindings;
+	for (const Binding &binding : m_Bindings)
+		bindings[binding.Index] = binding.Key;
+	return bindings;
+}
+
+void NodeArguments::ResolveBindings(BehaviourTree &tree) {
+	for (Binding &binding : m_Bindings) {
+		binding.Slot = std::numeric_limits<uint32_t>::max();
+		ERR_CONTINUE_MSG(binding.Index < 0 || binding.Index >= m_Values.size(), "Blackboard argument index out of bounds");
+		binding.Slot = tree.ResolveBlackboardSlot(binding.Key);
+	}
+	m_ResolvedTree = &tree;
+}
+
+const Variant **NodeArguments::GetPointers(BehaviourTree *tree) {
+	if (tree && !m_Bindings.empty()) {
+		// the slots are per tree, a shared node can be executed by many
+		if (m_ResolvedTree != tree)
+			ResolveBindings(*tree);
+
+		for (Binding &binding : m_Bindings) {
+			if (binding.Slot != std::numeric_limits<uint32_t>::max())
+				binding.Value = tree->GetBlackboardSlot(binding.Slot);
+		}
+	}
+	return m_Pointers.data();
+}
+
+void NodeArguments::BuildPointers() {
+	m_Pointers.resize(m_Values.size());
+	for (int i = 0; i < m_Values.size(); i++)
+		m_Pointers[i] = &m_Values[i];
+
+	// the bound arguments point to their copy, the slots of the previous values are resolved again by the next call
+	for (Binding &binding : m_Bindings) {
+		if (binding.Index >= 0 && binding.Index < m_Values.size())
+			m_Pointers[binding.Index] = &binding.Value;
+	}
+	m_ResolvedTree = nullptr;
+}
+} //namespace behaviour_tree::nodes
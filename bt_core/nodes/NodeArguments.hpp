@@ -0,0 +1,61 @@
+#pragma once
+
+#include "core/variant/array.h"
+#include "core/variant/dictionary.h"
+#include <vector>
+
+namespace behaviour_tree {
+class BehaviourTree;
+}
+namespace behaviour_tree::nodes {
+// Arguments of the nodes calling into the scene. The table of pointers passed to the calls is built when the
+// arguments are set, arguments bound to a blackboard key point to a copy of the key's value taken for the call
+class NodeArguments {
+public:
+	void SetValues(const Array &values);
+	// Copy of the values, the table points inside of the stored array
+	Array GetValues() const {
+		return m_Values.duplicate();
+	}
+
+	// Argument index to blackboard key
+	void SetBindings(const Dictionary &bindings);
+	Dictionary GetBindings() const;
+	bool HasBindings() const noexcept {
+		return !m_Bindings.empty();
+	}
+
+	// Resolves the keys of the bindings to the tree's slots, called when the node is initialized.
+	// Bindings set later, or used from another tree, are resolved by the next call
+	void ResolveBindings(BehaviourTree &tree);
+
+	// Table of the arguments for a call, the bound arguments are read from the blackboard of 'tree'
+	const Variant **GetPointers(BehaviourTree *tree);
+
+	const Variant &GetValue(int index) const {
+		return *m_Pointers[index];
+	}
+
+	int GetCount() const noexcept {
+		return static_cast<int>(m_Pointers.size());
+	}
+
+private:
+	struct Binding {
+		int Index;
+		StringName Key;
+		uint32_t Slot;
+		// the call may write to the blackboard and grow it, the bound argument can't point into it
+		Variant Value;
+	};
+
+	void BuildPointers();
+
+private:
+	Array m_Values;
+	std::vector<const Variant *> m_Pointers;
+	std::vector<Binding> m_Bindings;
+	// tree the slots of the bindings were resolved for
+	const BehaviourTree *m_ResolvedTree = nullptr;
+};
+} //namespace behaviour_tree::nodes
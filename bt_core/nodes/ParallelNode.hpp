@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../composite_node.hpp"
+#include "../program.hpp"
 
 namespace behaviour_tree::nodes {
 class BehaviourTreeParallelNode : public IBehaviourTreeCompositeNode {
@@ -23,6 +24,11 @@ public:
 		IBehaviourTreeCompositeNode::DeserializeNode(in_data);
 	}
 
+	void CompileNode(CompiledNode &compiled_node) const override {
+		compiled_node.Op = OpCode::Parallel;
+		compiled_node.Args.Parallel.Focus = static_cast<uint32_t>(m_FocusChildIndex);
+	}
+
 protected:
 	NodeState OnExecute() override {
 		for (auto &child : m_Childrens)
@@ -34,6 +40,7 @@ protected:
 private:
 	void SetFocusChildIndex(int index) {
 		m_FocusChildIndex = index;
+		NotifyStructureChanged();
 	}
 
 	int GetFocusChildIndex() {
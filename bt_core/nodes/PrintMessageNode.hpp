@@ -24,6 +24,10 @@ public:
 		IBehaviourTreeActionNode::DeserializeNode(in_data);
 	}
 
+	NodeThreading GetThreading() const override {
+		return NodeThreading::Any;
+	}
+
 protected:
 	NodeState OnExecute() override {
 		print_line(m_Message);
@@ -7,6 +7,16 @@ namespace behaviour_tree::nodes {
 class BehaviourTreeRandomFallbackNode : public BehaviourTreeFallbackNode {
 	GDCLASS(BehaviourTreeRandomFallbackNode, IBehaviourTreeCompositeNode);
 
+public:
+	// Childrens are shuffled on enter, so the node can't be laid out statically
+	void CompileNode(CompiledNode &compiled_node) const override {
+		compiled_node.Op = OpCode::Invoke;
+	}
+
+	NodeThreading GetThreading() const override {
+		return NodeThreading::Any;
+	}
+
 protected:
 	void OnEnter() override {
 		std::shuffle(m_Childrens.begin(), m_Childrens.end(), m_RandEngine);
@@ -1,7 +1,8 @@
 #pragma once
 
 #include "../decorator_node.hpp"
-#include "core/os/os.h"
+#include "../program.hpp"
+#include "../tree.hpp"
 
 namespace behaviour_tree::nodes {
 class BehaviourTreeTimeOutNode : public IBehaviourTreeDecoratorNode {
@@ -24,13 +25,18 @@ public:
 		m_Duration = in_data["duration"];
 	}
 
+	void CompileNode(CompiledNode &compiled_node) const override {
+		compiled_node.Op = OpCode::TimeOut;
+		compiled_node.Args.TimeOut.Duration = m_Duration;
+	}
+
 protected:
 	void OnEnter() override {
-		m_CurTime = OS::get_singleton()->get_unix_time() + m_Duration;
+		m_Deadline = GetTree()->GetClock().TimeUsec + TickClock::ToUsec(m_Duration);
 	}
 
 	NodeState OnExecute() override {
-		if (m_CurTime < OS::get_singleton()->get_unix_time())
+		if (m_Deadline < GetTree()->GetClock().TimeUsec)
 			return NodeState::Failure;
 		return m_Child->Execute();
 	}
@@ -38,6 +44,7 @@ protected:
 private:
 	void SetTimeOut(double duration) {
 		m_Duration = duration;
+		NotifyStructureChanged();
 	}
 	double GetTimeOut() const {
 		return m_Duration;
@@ -45,6 +52,6 @@ private:
 
 private:
 	double m_Duration = 0.f;
-	double m_CurTime = 0.f;
+	uint64_t m_Deadline = 0;
 };
 } //namespace behaviour_tree::nodes
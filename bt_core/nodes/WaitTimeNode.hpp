@@ -1,7 +1,8 @@
 #pragma once
 
 #include "../action_node.hpp"
-#include "core/os/os.h"
+#include "../program.hpp"
+#include "../tree.hpp"
 
 namespace behaviour_tree::nodes {
 class BehaviourTreeWaitTimeNode : public IBehaviourTreeActionNode {
@@ -24,18 +25,24 @@ public:
 		IBehaviourTreeActionNode::DeserializeNode(in_data);
 	}
 
+	void CompileNode(CompiledNode &compiled_node) const override {
+		compiled_node.Op = OpCode::WaitTime;
+		compiled_node.Args.WaitTime.Duration = m_Duration;
+	}
+
 protected:
 	void OnEnter() override {
-		m_CurTime = OS::get_singleton()->get_unix_time() + m_Duration;
+		m_Deadline = GetTree()->GetClock().TimeUsec + TickClock::ToUsec(m_Duration);
 	}
 
 	NodeState OnExecute() override {
-		return m_CurTime < OS::get_singleton()->get_unix_time() ? NodeState::Success : NodeState::Running;
+		return m_Deadline <= GetTree()->GetClock().TimeUsec ? NodeState::Success : NodeState::Running;
 	}
 
 private:
 	void SetWaitDuration(double duration) {
 		m_Duration = duration;
+		NotifyStructureChanged();
 	}
 	double GetWaitDuration() const {
 		return m_Duration;
@@ -43,6 +50,6 @@ private:
 
 private:
 	double m_Duration = 0.f;
-	double m_CurTime = 0.f;
+	uint64_t m_Deadline = 0;
 };
 } //namespace behaviour_tree::nodes
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "node_behaviour.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace behaviour_tree {
+/*
+States of the nodes packed at 2 bits per node, 32 nodes per word:
+
+	0	Inactive
+	1	Running
+	2	Success
+	3	Failure
+
+Inactive is 0 so resetting a range of nodes is clearing the words that hold it, and a scan for the running nodes
+tests a whole word at once.
+*/
+class PackedNodeStates {
+public:
+	static constexpr uint32_t NodesPerWord = 32;
+
+	static constexpr size_t GetWordCount(size_t node_count) noexcept {
+		return (node_count + NodesPerWord - 1) / NodesPerWord;
+	}
+
+	PackedNodeStates() = default;
+	explicit PackedNodeStates(uint64_t *words) noexcept :
+			m_Words(words) {}
+
+	NodeState Get(uint32_t index) const noexcept {
+		const uint64_t code = (m_Words[index / NodesPerWord] >> Shift(index)) & 3;
+		return static_cast<NodeState>(static_cast<int>(code) - 1);
+	}
+
+	void Set(uint32_t index, NodeState state) noexcept {
+		const uint64_t code = static_cast<uint64_t>(static_cast<int>(state) + 1);
+		uint64_t &word = m_Words[index / NodesPerWord];
+		word = (word & ~(uint64_t(3) << Shift(index))) | (code << Shift(index));
+	}
+
+	// Sets the nodes in [begin, end) to inactive
+	void Reset(uint32_t begin, uint32_t end) noexcept {
+		if (begin >= end)
+			return;
+
+		const uint32_t first = begin / NodesPerWord, last = (end - 1) / NodesPerWord;
+		if (first == last) {
+			m_Words[first] &= ~RangeMask(begin, end);
+			return;
+		}
+
+		m_Words[first] &= ~RangeMask(begin, (first + 1) * NodesPerWord);
+		// whole words in between, a plain fill the compiler turns into vector stores
+		std::fill(m_Words + first + 1, m_Words + last, uint64_t(0));
+		m_Words[last] &= ~RangeMask(last * NodesPerWord, end);
+	}
+
+	// First running node in [begin, end), or 'end' if there is none
+	uint32_t FindRunning(uint32_t begin, uint32_t end) const noexcept {
+		for (uint32_t word_index = begin / NodesPerWord; word_index * NodesPerWord < end; word_index++) {
+			const uint32_t word_begin = std::max(begin, word_index * NodesPerWord);
+			const uint32_t word_end = std::min(end, (word_index + 1) * NodesPerWord);
+
+			const uint64_t running = RunningBits(m_Words[word_index]) & RangeMask(word_begin, word_end);
+			if (running)
+				return word_index * NodesPerWord + CountTrailingZeros(running) / 2;
+		}
+		return end;
+	}
+
+	uint32_t CountRunning(uint32_t begin, uint32_t end) const noexcept {
+		uint32_t count = 0;
+		for (uint32_t word_index = begin / NodesPerWord; word_index * NodesPerWord < end; word_index++) {
+			const uint32_t word_begin = std::max(begin, word_index * NodesPerWord);
+			const uint32_t word_end = std::min(end, (word_index + 1) * NodesPerWord);
+			count += PopCount(RunningBits(m_Words[word_index]) & RangeMask(word_begin, word_end));
+		}
+		return count;
+	}
+
+	const uint64_t *GetWords() const noexcept {
+		return m_Words;
+	}
+
+private:
+	static constexpr uint32_t Shift(uint32_t index) noexcept {
+		return (index % NodesPerWord) * 2;
+	}
+
+	// Bits of the nodes in [begin, end), both in the same word
+	static constexpr uint64_t RangeMask(uint32_t begin, uint32_t end) noexcept {
+		const uint32_t count = end - begin;
+		const uint64_t mask = count == NodesPerWord ? ~uint64_t(0) : (uint64_t(1) << (count * 2)) - 1;
+		return mask << Shift(begin);
+	}
+
+	// Low bit of each node that is running, '01'
+	static constexpr uint64_t RunningBits(uint64_t word) noexcept {
+		constexpr uint64_t low_bits = 0x5555555555555555ull;
+		return word & ~(word >> 1) & low_bits;
+	}
+
+	static uint32_t CountTrailingZeros(uint64_t value) noexcept {
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return static_cast<uint32_t>(index);
+#else
+		return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+	}
+
+	static uint32_t PopCount(uint64_t value) noexcept {
+#if defined(_MSC_VER)
+		return static_cast<uint32_t>(__popcnt64(value));
+#else
+		return static_cast<uint32_t>(__builtin_popcountll(value));
+#endif
+	}
+
+private:
+	uint64_t *m_Words = nullptr;
+};
+} //namespace behaviour_tree
@@ -0,0 +1,677 @@
+#include <algorithm>
+#include <limits>
+
+#include "program.hpp"
+#include "composite_node.hpp"
+#include "decorator_node.hpp"
+#include "tree.hpp"
+#include "core/os/os.h"
+#include "nodes/BlackboardConditionNode.hpp"
+
+namespace behaviour_tree {
+bool BehaviourTreeProgram::Compile(const std::vector<Ref<IBehaviourTreeNodeBehaviour>> &nodes, int root_index) {
+	m_Nodes.clear();
+	m_ProgramIndices.clear();
+	m_InstancedIndices.clear();
+	m_MaxDepth = 0;
+	m_Threading = NodeThreading::Any;
+	// taken before the nodes, an edit made while compiling makes the program check them again
+	m_DefinitionGeneration.store(IBehaviourTreeNodeBehaviour::GetDefinitionGeneration(), std::memory_order_relaxed);
+
+	ERR_FAIL_INDEX_V(root_index, static_cast<int>(nodes.size()), false);
+
+	CompileContext context;
+	context.Visiting.resize(nodes.size(), false);
+	for (size_t i = 0; i < nodes.size(); i++)
+		context.Indices.emplace(*nodes[i], static_cast<uint32_t>(i));
+
+	if (!Flatten(*nodes[root_index], std::numeric_limits<uint32_t>::max(), 0, false, context)) {
+		m_Nodes.clear();
+		return false;
+	}
+
+	m_ProgramIndices.resize(nodes.size(), std::numeric_limits<uint32_t>::max());
+	for (uint32_t i = 0; i < m_Nodes.size(); i++) {
+		m_ProgramIndices[m_Nodes[i].NodeIndex] = i;
+		if (m_Nodes[i].Instanced)
+			m_InstancedIndices.push_back(i);
+	}
+
+	m_MaxDepth = context.MaxDepth;
+	return true;
+}
+
+bool BehaviourTreeProgram::IsCompiledFrom(const std::vector<Ref<IBehaviourTreeNodeBehaviour>> &nodes) const {
+	if (m_ProgramIndices.size() != nodes.size())
+		return false;
+
+	for (const CompiledNode &node : m_Nodes) {
+		if (*nodes[node.NodeIndex] != node.Node || node.Node->GetGeneration() != node.Generation)
+			return false;
+	}
+	return true;
+}
+
+bool BehaviourTreeProgram::IsUpToDate() const {
+	const uint64_t generation = IBehaviourTreeNodeBehaviour::GetDefinitionGeneration();
+	if (m_DefinitionGeneration.load(std::memory_order_relaxed) == generation)
+		return true;
+
+	for (const CompiledNode &node : m_Nodes) {
+		if (node.Node->GetGeneration() != node.Generation)
+			return false;
+	}
+
+	// the edits were made to other trees
+	m_DefinitionGeneration.store(generation, std::memory_order_relaxed);
+	return true;
+}
+
+bool BehaviourTreeProgram::Flatten(IBehaviourTreeNodeBehaviour *node, uint32_t parent, uint32_t depth, bool instanced, CompileContext &context) {
+	ERR_FAIL_NULL_V_MSG(node, false, "Invalid child node in behaviour tree");
+
+	auto node_index = context.Indices.find(node);
+	ERR_FAIL_COND_V_MSG(node_index == context.Indices.end(), false, "Node is not part of the behaviour tree");
+	ERR_FAIL_COND_V_MSG(context.Visiting[node_index->second], false, "Behaviour tree contains a cycle");
+
+	const uint32_t index = static_cast<uint32_t>(m_Nodes.size());
+	{
+		CompiledNode &compiled = m_Nodes.emplace_back();
+		compiled.NodeIndex = node_index->second;
+		compiled.Parent = parent;
+		compiled.Node = node;
+		compiled.Generation = node->GetGeneration();
+		node->CompileNode(compiled);
+
+		// childrens of a node executed through its object are executed by the node itself
+		compiled.Instanced = instanced || compiled.Op == OpCode::Invoke;
+		instanced = compiled.Instanced;
+
+		if (compiled.Op == OpCode::Invoke)
+			m_Threading = std::max(m_Threading, node->GetThreading());
+	}
+	context.MaxDepth = std::max(context.MaxDepth, depth + 1);
+
+	context.Visiting[node_index->second] = true;
+	for (IBehaviourTreeNodeBehaviour *child : node->GetChildrens()) {
+		if (!Flatten(child, index, depth + 1, instanced, context))
+			return false;
+	}
+	context.Visiting[node_index->second] = false;
+
+	CompiledNode &compiled = m_Nodes[index];
+	compiled.SubtreeEnd = static_cast<uint32_t>(m_Nodes.size());
+
+	if (compiled.Op == OpCode::Parallel) {
+		uint32_t child = index + 1;
+		for (uint32_t i = 0; i < compiled.Args.Parallel.Focus && child < compiled.SubtreeEnd; i++)
+			child = m_Nodes[child].SubtreeEnd;
+		compiled.Args.Parallel.Focus = child < compiled.SubtreeEnd ? child : std::numeric_limits<uint32_t>::max();
+	}
+	return true;
+}
+
+bool BehaviourTreeProgram::AcquireRuntime(BehaviourTreeProgramRuntime &runtime) const {
+	MutexLock lock(m_RuntimesLock);
+	m_LastPoolUseUsec = OS::get_singleton()->get_ticks_usec();
+	if (m_Runtimes.empty())
+		return false;
+
+	runtime = std::move(m_Runtimes.back());
+	m_Runtimes.pop_back();
+	return true;
+}
+
+void BehaviourTreeProgram::ReleaseRuntime(BehaviourTreeProgramRuntime &&runtime) const {
+	MutexLock lock(m_RuntimesLock);
+	m_LastPoolUseUsec = OS::get_singleton()->get_ticks_usec();
+	// past the cap the runtime is left to its agent and freed with it
+	if (m_Runtimes.size() < MaxPooledRuntimes)
+		m_Runtimes.emplace_back(std::move(runtime));
+}
+
+void BehaviourTreeProgram::RetainPool(const std::shared_ptr<const BehaviourTreeProgram> &program) {
+	MutexLock lock(PoolsLock);
+	if (program->m_IsPoolRetained)
+		return;
+	program->m_IsPoolRetained = true;
+	Pools.push_back(program);
+}
+
+void BehaviourTreeProgram::TrimRuntimePools(uint32_t max_frees) {
+	// freed once the locks are released
+	std::vector<BehaviourTreeProgramRuntime> freed;
+	std::vector<std::shared_ptr<const BehaviourTreeProgram>> released;
+	{
+		MutexLock lock(PoolsLock);
+		const uint64_t now = OS::get_singleton()->get_ticks_usec();
+
+		for (size_t i = 0; i < Pools.size() && freed.size() < max_frees;) {
+			const BehaviourTreeProgram *program = Pools[i].get();
+			// still run by agents, or only just left
+			if (Pools[i].use_count() > 1) {
+				i++;
+				continue;
+			}
+
+			MutexLock runtimes_lock(program->m_RuntimesLock);
+			if (now - program->m_LastPoolUseUsec < PoolIdleUsec) {
+				i++;
+				continue;
+			}
+
+			while (!program->m_Runtimes.empty() && freed.size() < max_frees) {
+				freed.emplace_back(std::move(program->m_Runtimes.back()));
+				program->m_Runtimes.pop_back();
+			}
+
+			if (!program->m_Runtimes.empty()) {
+				i++;
+				continue;
+			}
+			Pools[i]->m_IsPoolRetained = false;
+			released.emplace_back(std::move(Pools[i]));
+			Pools[i] = std::move(Pools.back());
+			Pools.pop_back();
+		}
+	}
+}
+
+void BehaviourTreeProgram::ClearRuntimePools() {
+	std::vector<std::shared_ptr<const BehaviourTreeProgram>> released;
+	{
+		MutexLock lock(PoolsLock);
+		for (auto &program : Pools)
+			program->m_IsPoolRetained = false;
+		released.swap(Pools);
+	}
+	for (auto &program : released) {
+		MutexLock lock(program->m_RuntimesLock);
+		program->m_Runtimes.clear();
+	}
+}
+
+BehaviourTreeProgramState::BehaviourTreeProgramState(std::shared_ptr<const BehaviourTreeProgram> program, BehaviourTree *owner, bool pooled) :
+		m_Program(std::move(program)),
+		m_Pooled(pooled),
+		m_Owner(owner) {
+	const size_t node_count = m_Program->m_Nodes.size();
+	const size_t max_depth = m_Program->m_MaxDepth;
+
+	const size_t instances_offset = sizeof(NodeScratch) * node_count;
+	const size_t stack_offset = instances_offset + sizeof(IBehaviourTreeNodeBehaviour *) * node_count;
+	const size_t path_offset = stack_offset + sizeof(Frame) * max_depth;
+	const size_t states_offset = path_offset + sizeof(Frame) * max_depth;
+	const size_t block_size = states_offset + sizeof(uint64_t) * PackedNodeStates::GetWordCount(node_count);
+
+	if (m_Pooled)
+		BehaviourTreeProgram::RetainPool(m_Program);
+	const bool reused = m_Pooled && m_Program->AcquireRuntime(m_Runtime);
+	if (reused)
+		std::fill_n(m_Runtime.Block.get(), block_size, 0);
+	else
+		m_Runtime.Block = std::make_unique<uint8_t[]>(block_size);
+	uint8_t *block = m_Runtime.Block.get();
+
+	m_Scratch = reinterpret_cast<NodeScratch *>(block);
+	m_Instances = reinterpret_cast<IBehaviourTreeNodeBehaviour **>(block + instances_offset);
+	m_Stack = reinterpret_cast<Frame *>(block + stack_offset);
+	m_RunningPath = reinterpret_cast<Frame *>(block + path_offset);
+	// the block is zeroed, all the nodes are inactive
+	m_States = PackedNodeStates(reinterpret_cast<uint64_t *>(block + states_offset));
+
+	std::fill_n(m_Instances, node_count, nullptr);
+
+	if (reused)
+		ReuseNodes(owner);
+	else
+		InstantiateNodes(owner);
+	ResolveConditions();
+}
+
+BehaviourTreeProgramState::~BehaviourTreeProgramState() {
+	// the copies can be kept alive by a reference taken elsewhere, they mustn't point to a dead tree
+	for (auto &node : m_Runtime.InstancedNodes)
+		node->SetOwnerTree(nullptr);
+
+	if (!m_Pooled)
+		return;
+
+	// a single move, the copies are only rewound by the agent that takes them
+	m_Runtime.Observers.clear();
+	m_Runtime.ObservedSlots.clear();
+	m_Runtime.ChangedSlots.clear();
+	m_Program->ReleaseRuntime(std::move(m_Runtime));
+}
+
+void BehaviourTreeProgramState::InstantiateNodes(BehaviourTree *owner) {
+	const std::vector<CompiledNode> &nodes = m_Program->m_Nodes;
+	for (uint32_t i = 0; i < nodes.size(); i++) {
+		if (!nodes[i].Instanced)
+			continue;
+
+		Ref<IBehaviourTreeNodeBehaviour> instance = nodes[i].Node->duplicate();
+		instance->m_ProgramIndex = i;
+		m_Instances[i] = *instance;
+		m_Runtime.InstancedNodes.emplace_back(std::move(instance));
+	}
+
+	// the copies still point to the shared childrens, childrens of instanced nodes are instanced too
+	for (uint32_t i = 0; i < nodes.size(); i++) {
+		if (!nodes[i].Instanced || i + 1 == nodes[i].SubtreeEnd)
+			continue;
+
+		if (auto composite = Object::cast_to<IBehaviourTreeCompositeNode>(m_Instances[i])) {
+			std::vector<Ref<IBehaviourTreeNodeBehaviour>> childrens;
+			for (uint32_t child = i + 1; child < nodes[i].SubtreeEnd; child = nodes[child].SubtreeEnd)
+				childrens.emplace_back(m_Instances[child]);
+			composite->SetChildrens(std::move(childrens));
+		} else if (auto decorator = Object::cast_to<IBehaviourTreeDecoratorNode>(m_Instances[i]))
+			decorator->SetChild(m_Instances[i + 1]);
+	}
+
+	// only now, relinking the childrens would invalidate the owner's program
+	for (auto &node : m_Runtime.InstancedNodes)
+		node->SetOwnerTree(owner);
+}
+
+void BehaviourTreeProgramState::ReuseNodes(BehaviourTree *owner) {
+	// the copies are released in the order of the program and are still linked to each other
+	const std::vector<CompiledNode> &nodes = m_Program->m_Nodes;
+	auto instance = m_Runtime.InstancedNodes.begin();
+	for (uint32_t i = 0; i < nodes.size(); i++) {
+		if (nodes[i].Instanced)
+			m_Instances[i] = *(*instance++);
+	}
+
+	for (auto &node : m_Runtime.InstancedNodes) {
+		node->SetOwnerTree(owner);
+		node->Rewind();
+	}
+}
+
+void BehaviourTreeProgramState::ResolveConditions() {
+	const std::vector<CompiledNode> &nodes = m_Program->m_Nodes;
+	for (uint32_t i = 0; i < nodes.size(); i++) {
+		if (nodes[i].Op != OpCode::BlackboardCondition || nodes[i].Instanced)
+			continue;
+
+		auto condition = static_cast<const nodes::BehaviourTreeBlackboardConditionNode *>(nodes[i].Node);
+		const uint32_t slot = m_Owner->ResolveBlackboardSlot(condition->GetKey());
+		m_Scratch[i].Slot = slot;
+
+		if (nodes[i].Args.BlackboardCondition.AbortMode != nodes::BehaviourTreeBlackboardConditionNode::AbortNone) {
+			m_Runtime.Observers.push_back(i);
+			if (m_Runtime.ObservedSlots.size() <= slot)
+				m_Runtime.ObservedSlots.resize(slot + 1, false);
+			m_Runtime.ObservedSlots[slot] = true;
+		}
+	}
+}
+
+bool BehaviourTreeProgramState::OnBlackboardChanged(uint32_t slot) {
+	if (slot >= m_Runtime.ObservedSlots.size() || !m_Runtime.ObservedSlots[slot])
+		return false;
+
+	if (std::find(m_Runtime.ChangedSlots.begin(), m_Runtime.ChangedSlots.end(), slot) == m_Runtime.ChangedSlots.end())
+		m_Runtime.ChangedSlots.push_back(slot);
+	return true;
+}
+
+bool BehaviourTreeProgramState::CheckCondition(uint32_t index) const {
+	auto condition = static_cast<const nodes::BehaviourTreeBlackboardConditionNode *>(m_Program->m_Nodes[index].Node);
+	return condition->Check(m_Owner->GetBlackboardSlot(m_Scratch[index].Slot));
+}
+
+void BehaviourTreeProgramState::ProcessObservers() {
+	for (uint32_t slot : m_Runtime.ChangedSlots) {
+		for (uint32_t index : m_Runtime.Observers) {
+			if (m_Scratch[index].Slot == slot)
+				EvaluateObserver(index);
+		}
+	}
+	m_Runtime.ChangedSlots.clear();
+}
+
+void BehaviourTreeProgramState::EvaluateObserver(uint32_t index) {
+	using ConditionNode = nodes::BehaviourTreeBlackboardConditionNode;
+
+	const std::vector<CompiledNode> &nodes = m_Program->m_Nodes;
+	const CompiledNode &node = nodes[index];
+	const uint8_t abort_mode = node.Args.BlackboardCondition.AbortMode;
+	const bool passes = CheckCondition(index);
+
+	// the condition doesn't hold anymore, the running childrens are stopped and the parent will see it fail
+	if ((abort_mode & ConditionNode::AbortSelf) && !passes && m_States.Get(index) == NodeState::Running) {
+		AbortRange(index, node.SubtreeEnd);
+		ClearRunningPath();
+	}
+
+	// the condition holds now, stop the running siblings after it so the parent goes through it again
+	if ((abort_mode & ConditionNode::AbortLowerPriority) && passes && m_States.Get(index) != NodeState::Running && node.Parent != std::numeric_limits<uint32_t>::max()) {
+		const uint32_t end = nodes[node.Parent].SubtreeEnd;
+		if (IsRunning(node.SubtreeEnd, end)) {
+			AbortRange(node.SubtreeEnd, end);
+			RewindRange(index, node.SubtreeEnd);
+			ClearRunningPath();
+		}
+	}
+}
+
+void BehaviourTreeProgramState::InitializeNodes() {
+	for (auto &node : m_Runtime.InstancedNodes)
+		node->Initialize();
+}
+
+// Nodes that only react once their running child returns, while it keeps running they would just pass its state up
+static bool IsTransparent(const CompiledNode &node) noexcept {
+	switch (node.Op) {
+		case OpCode::Sequence:
+		case OpCode::Fallback:
+		case OpCode::AlwaysSuccess:
+		case OpCode::AlwaysFailure:
+		case OpCode::Loop:
+			return true;
+		case OpCode::Converter:
+			return node.Args.Converter.Running == NodeState::Running;
+		// an observed condition is only checked again when its slot changes, the observer aborts it if it fails
+		case OpCode::BlackboardCondition:
+			return !node.Instanced && (node.Args.BlackboardCondition.AbortMode & nodes::BehaviourTreeBlackboardConditionNode::AbortSelf);
+		default:
+			return false;
+	}
+}
+
+NodeState BehaviourTreeProgramState::Execute(bool resume_running) {
+	const std::vector<CompiledNode> &nodes = m_Program->m_Nodes;
+	ERR_FAIL_COND_V(nodes.empty(), NodeState::Failure);
+
+	if (!m_Runtime.ChangedSlots.empty())
+		ProcessObservers();
+
+	uint32_t depth = 0;
+
+	// Frames below 'resumed_depth' are restored from the running path of the last tick, they are all running and transparent.
+	// The tick starts at the first node of the path that has to be visited every tick, or at the running node itself
+	uint32_t resumed_depth = 0;
+	if (resume_running && m_RunningDepth) {
+		while (resumed_depth < m_RunningDepth - 1 && IsTransparent(nodes[m_RunningPath[resumed_depth].Index]))
+			resumed_depth++;
+
+		std::copy_n(m_RunningPath, resumed_depth + 1, m_Stack);
+		depth = resumed_depth + 1;
+	} else
+		m_Stack[depth++] = { 0, 0 };
+	m_RunningDepth = 0;
+
+	m_WakeTime = std::numeric_limits<uint64_t>::max();
+	m_CanSleep = true;
+
+	// 'entering' is set when a node is visited for the first time in this tick,
+	// otherwise we are coming back from the child in 'Frame::Child' and 'state' holds its result
+	bool entering = true;
+	NodeState state = NodeState::Inactive;
+
+	while (true) {
+		Frame &frame = m_Stack[depth - 1];
+		const CompiledNode &node = nodes[frame.Index];
+		const uint32_t first_child = frame.Index + 1;
+		const NodeState child_state = state;
+		bool finished = false;
+
+		if (entering) {
+			if (node.Op != OpCode::Invoke && m_States.Get(frame.Index) == NodeState::Inactive)
+				EnterNode(frame.Index);
+			frame.Child = first_child;
+		}
+
+		switch (node.Op) {
+			case OpCode::Invoke: {
+				state = m_Instances[frame.Index]->Execute();
+				finished = true;
+				break;
+			}
+
+			// A sequence skips its succeeded childrens and stops at the first one that didn't succeed,
+			// a fallback does the same with failed childrens
+			case OpCode::Sequence:
+			case OpCode::Fallback: {
+				const NodeState skip_state = node.Op == OpCode::Sequence ? NodeState::Success : NodeState::Failure;
+				if (!entering) {
+					if (state != skip_state) {
+						finished = true;
+						break;
+					}
+					frame.Child = nodes[frame.Child].SubtreeEnd;
+				}
+
+				while (frame.Child < node.SubtreeEnd && GetState(frame.Child) == skip_state)
+					frame.Child = nodes[frame.Child].SubtreeEnd;
+
+				if (frame.Child == node.SubtreeEnd) {
+					state = skip_state;
+					finished = true;
+				}
+				break;
+			}
+
+			case OpCode::Parallel: {
+				if (!entering)
+					frame.Child = nodes[frame.Child].SubtreeEnd;
+
+				if (frame.Child == node.SubtreeEnd) {
+					const uint32_t focus = node.Args.Parallel.Focus;
+					state = focus < node.SubtreeEnd ? GetState(focus) : NodeState::Failure;
+					finished = true;
+				}
+				break;
+			}
+
+			case OpCode::Interruptor: {
+				if (!entering) {
+					if (state != NodeState::Failure) {
+						AbortRange(first_child, node.SubtreeEnd);
+						finished = true;
+						break;
+					}
+					frame.Child = nodes[frame.Child].SubtreeEnd;
+				}
+
+				if (frame.Child == node.SubtreeEnd) {
+					state = NodeState::Failure;
+					finished = true;
+				}
+				break;
+			}
+
+			case OpCode::AlwaysSuccess:
+			case OpCode::AlwaysFailure:
+			case OpCode::Converter: {
+				if (entering) {
+					if (first_child == node.SubtreeEnd) {
+						state = NodeState::Failure;
+						finished = true;
+					}
+					break;
+				}
+
+				if (node.Op == OpCode::Converter) {
+					switch (state) {
+						case NodeState::Success:
+							state = node.Args.Converter.Success;
+							break;
+						case NodeState::Failure:
+							state = node.Args.Converter.Failure;
+							break;
+						default:
+							state = node.Args.Converter.Running;
+							break;
+					}
+				} else if (state != NodeState::Running)
+					state = node.Op == OpCode::AlwaysSuccess ? NodeState::Success : NodeState::Failure;
+
+				finished = true;
+				break;
+			}
+
+			case OpCode::Loop: {
+				int32_t &loop_count = m_Scratch[frame.Index].LoopCount;
+				if (entering) {
+					if (loop_count == 0 || loop_count < -1) {
+						state = NodeState::Success;
+						finished = true;
+					} else if (first_child == node.SubtreeEnd) {
+						state = NodeState::Failure;
+						finished = true;
+					}
+					break;
+				}
+
+				if (state != NodeState::Running) {
+					if (state == NodeState::Failure && node.Args.Loop.ExitOnFailure) {
+						finished = true;
+						break;
+					}
+
+					RewindRange(first_child, node.SubtreeEnd);
+					if (loop_count != -1)
+						--loop_count;
+				}
+
+				state = NodeState::Running;
+				finished = true;
+				break;
+			}
+
+			case OpCode::TimeOut: {
+				if (entering) {
+					if (first_child == node.SubtreeEnd || m_Scratch[frame.Index].Deadline < m_Owner->GetClock().TimeUsec) {
+						state = NodeState::Failure;
+						finished = true;
+					}
+					break;
+				}
+
+				finished = true;
+				break;
+			}
+
+			case OpCode::BlackboardCondition: {
+				if (entering) {
+					if (first_child == node.SubtreeEnd || !CheckCondition(frame.Index)) {
+						state = NodeState::Failure;
+						finished = true;
+					}
+					break;
+				}
+
+				finished = true;
+				break;
+			}
+
+			case OpCode::WaitTime: {
+				state = m_Scratch[frame.Index].Deadline <= m_Owner->GetClock().TimeUsec ? NodeState::Success : NodeState::Running;
+				finished = true;
+				break;
+			}
+		}
+
+		if (finished) {
+			if (node.Op != OpCode::Invoke)
+				m_States.Set(frame.Index, state);
+
+			if (state == NodeState::Running) {
+				// the first node to keep running in this tick holds the deepest running path
+				if (!m_RunningDepth) {
+					std::copy_n(m_Stack, depth, m_RunningPath);
+					m_RunningDepth = depth;
+				}
+				UpdateWakeTime(frame.Index, entering ? NodeState::Inactive : child_state);
+			}
+
+			if (--depth == 0)
+				return state;
+
+			if (depth <= resumed_depth) {
+				if (state == NodeState::Running)
+					return state;
+				resumed_depth = depth;
+			}
+			entering = false;
+		} else {
+			m_Stack[depth++] = { frame.Child, 0 };
+			entering = true;
+		}
+	}
+}
+
+bool BehaviourTreeProgramState::IsRunning(uint32_t begin, uint32_t end) const noexcept {
+	if (m_States.FindRunning(begin, end) != end)
+		return true;
+
+	const std::vector<uint32_t> &instanced = m_Program->m_InstancedIndices;
+	for (auto i = std::lower_bound(instanced.begin(), instanced.end(), begin); i != instanced.end() && *i < end; i++) {
+		if (m_Instances[*i]->GetState() == NodeState::Running)
+			return true;
+	}
+	return false;
+}
+
+void BehaviourTreeProgramState::RewindRange(uint32_t begin, uint32_t end) {
+	m_States.Reset(begin, end);
+
+	const std::vector<uint32_t> &instanced = m_Program->m_InstancedIndices;
+	for (auto i = std::lower_bound(instanced.begin(), instanced.end(), begin); i != instanced.end() && *i < end; i++)
+		m_Instances[*i]->Rewind();
+}
+
+void BehaviourTreeProgramState::AbortRange(uint32_t begin, uint32_t end) {
+	m_States.Reset(begin, end);
+
+	const std::vector<uint32_t> &instanced = m_Program->m_InstancedIndices;
+	for (auto i = std::lower_bound(instanced.begin(), instanced.end(), begin); i != instanced.end() && *i < end; i++) {
+		IBehaviourTreeNodeBehaviour *node = m_Instances[*i];
+		if (node->GetState() != NodeState::Inactive)
+			node->OnExit();
+		node->Rewind();
+	}
+}
+
+void BehaviourTreeProgramState::UpdateWakeTime(uint32_t index, NodeState child_state) {
+	const CompiledNode &node = m_Program->m_Nodes[index];
+	switch (node.Op) {
+		case OpCode::WaitTime:
+			m_WakeTime = std::min(m_WakeTime, m_Scratch[index].Deadline);
+			break;
+		case OpCode::TimeOut:
+			// fails once the clock is past the deadline
+			m_WakeTime = std::min(m_WakeTime, m_Scratch[index].Deadline + 1);
+			break;
+		case OpCode::Invoke:
+			m_CanSleep = false;
+			break;
+		default:
+			// running on its own, like a loop restarting its child
+			if (child_state != NodeState::Running)
+				m_CanSleep = false;
+			break;
+	}
+}
+
+void BehaviourTreeProgramState::EnterNode(uint32_t index) {
+	const CompiledNode &node = m_Program->m_Nodes[index];
+	switch (node.Op) {
+		case OpCode::Loop:
+			m_Scratch[index].LoopCount = node.Args.Loop.Count;
+			break;
+		case OpCode::TimeOut:
+			m_Scratch[index].Deadline = m_Owner->GetClock().TimeUsec + TickClock::ToUsec(node.Args.TimeOut.Duration);
+			break;
+		case OpCode::WaitTime:
+			m_Scratch[index].Deadline = m_Owner->GetClock().TimeUsec + TickClock::ToUsec(node.Args.WaitTime.Duration);
+			break;
+		default:
+			break;
+	}
+}
+} //namespace behaviour_tree
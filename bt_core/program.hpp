@@ -0,0 +1,278 @@
+#pragma once
+
+#include "node_behaviour.hpp"
+#include "packed_states.hpp"
+#include "core/os/mutex.h"
+#include <atomic>
+#include <limits>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace behaviour_tree {
+/*
+Compiled form of a behaviour tree, nodes reachable from the root are laid out in pre-order:
+
+	[index]						the node itself
+	[index + 1, SubtreeEnd)		the childrens of the node and their own subtrees
+	[SubtreeEnd]				the next sibling of the node
+
+Composites and decorators that are known to the program are executed by the interpreter loop,
+anything else is executed through its node object and its childrens are left to the node itself.
+*/
+enum class OpCode : uint8_t {
+	Invoke,
+
+	Sequence,
+	Fallback,
+	Parallel,
+	Interruptor,
+
+	AlwaysSuccess,
+	AlwaysFailure,
+	Converter,
+	Loop,
+	TimeOut,
+	BlackboardCondition,
+
+	WaitTime
+};
+
+struct CompiledNode {
+	OpCode Op = OpCode::Invoke;
+	uint32_t SubtreeEnd = 0;
+	// UINT32_MAX for the root
+	uint32_t Parent = std::numeric_limits<uint32_t>::max();
+	uint32_t NodeIndex = 0;
+	IBehaviourTreeNodeBehaviour *Node = nullptr;
+	// generation of the node when it was compiled
+	uint32_t Generation = 0;
+
+	union {
+		struct {
+			// position of the focused child, resolved to its index in the program once compiled
+			uint32_t Focus;
+		} Parallel;
+		struct {
+			NodeState Success, Failure, Running;
+		} Converter;
+		struct {
+			int32_t Count;
+			bool ExitOnFailure;
+		} Loop;
+		struct {
+			double Duration;
+		} TimeOut;
+		struct {
+			uint8_t AbortMode;
+		} BlackboardCondition;
+		struct {
+			double Duration;
+		} WaitTime;
+	} Args{};
+
+	// executed through a per agent copy of the node, either it is not known to the interpreter or its parent isn't
+	bool Instanced = false;
+};
+
+// Allocations of an agent's state, pooled agents give them back to the program when they die
+struct BehaviourTreeProgramRuntime {
+	std::unique_ptr<uint8_t[]> Block;
+	std::vector<Ref<IBehaviourTreeNodeBehaviour>> InstancedNodes;
+
+	std::vector<uint32_t> Observers;
+	std::vector<bool> ObservedSlots;
+	std::vector<uint32_t> ChangedSlots;
+};
+
+// Immutable compiled form of a tree, shared by every agent that runs it
+class BehaviourTreeProgram {
+	friend class BehaviourTreeProgramState;
+
+public:
+	bool Compile(const std::vector<Ref<IBehaviourTreeNodeBehaviour>> &nodes, int root_index);
+
+	const std::vector<CompiledNode> &GetNodes() const noexcept {
+		return m_Nodes;
+	}
+
+	// Checks if the program was compiled from the same nodes, in the same order, and none was edited since
+	bool IsCompiledFrom(const std::vector<Ref<IBehaviourTreeNodeBehaviour>> &nodes) const;
+	// Checks that none of the nodes was edited since the program was compiled, a single load when no node was
+	bool IsUpToDate() const;
+
+	// Most restrictive threading of the nodes executed through their object
+	NodeThreading GetThreading() const noexcept {
+		return m_Threading;
+	}
+
+	// Position of the tree's node in the program, or UINT32_MAX if it is unreachable from the root
+	uint32_t GetProgramIndex(size_t node_index) const noexcept {
+		return node_index < m_ProgramIndices.size() ? m_ProgramIndices[node_index] : std::numeric_limits<uint32_t>::max();
+	}
+
+	// Runtimes kept per program, the agents dying past it free theirs
+	static constexpr size_t MaxPooledRuntimes = 1024;
+	// Time a pool is kept once no agent runs its program anymore, for the next wave of agents
+	static constexpr uint64_t PoolIdleUsec = 10000000;
+
+	// Frees at most 'max_frees' runtimes from the pools left idle, the program goes with its last one.
+	// Called on each tick so the runtimes of a despawned wave are freed over many frames
+	static void TrimRuntimePools(uint32_t max_frees);
+	static void ClearRuntimePools();
+
+private:
+	struct CompileContext {
+		std::map<const IBehaviourTreeNodeBehaviour *, uint32_t> Indices;
+		std::vector<bool> Visiting;
+		uint32_t MaxDepth = 0;
+	};
+
+	bool Flatten(IBehaviourTreeNodeBehaviour *node, uint32_t parent, uint32_t depth, bool instanced, CompileContext &context);
+
+	bool AcquireRuntime(BehaviourTreeProgramRuntime &runtime) const;
+	void ReleaseRuntime(BehaviourTreeProgramRuntime &&runtime) const;
+	// Keeps the program and its pool alive once its agents are gone
+	static void RetainPool(const std::shared_ptr<const BehaviourTreeProgram> &program);
+
+private:
+	std::vector<CompiledNode> m_Nodes;
+	std::vector<uint32_t> m_ProgramIndices;
+	// program indices of the nodes executed through a per agent copy, in order
+	std::vector<uint32_t> m_InstancedIndices;
+	uint32_t m_MaxDepth = 0;
+	NodeThreading m_Threading = NodeThreading::Any;
+	// definition generation the nodes were last checked against
+	mutable std::atomic<uint64_t> m_DefinitionGeneration{ 0 };
+
+	// runtimes of the dead pooled agents, the program is shared as const
+	mutable Mutex m_RuntimesLock;
+	mutable std::vector<BehaviourTreeProgramRuntime> m_Runtimes;
+	mutable uint64_t m_LastPoolUseUsec = 0;
+	// guarded by PoolsLock
+	mutable bool m_IsPoolRetained = false;
+
+	static inline Mutex PoolsLock;
+	static inline std::vector<std::shared_ptr<const BehaviourTreeProgram>> Pools;
+};
+
+/*
+Runtime state of a single agent running a program, allocated in a single block:
+
+	NodeScratch		[node count]		loop counters and timers of the native nodes
+	Node pointers	[node count]		per agent copy of the nodes that are executed through their object, or null
+	Frame			[max depth]			execution stack
+	Frame			[max depth]			running path of the last tick
+	uint64_t		[node count / 32]	state of the native nodes, 2 bits each
+
+Nodes executed by the interpreter only exist once in the program, their state lives in this block.
+
+A pooled state takes the block and the copies of the nodes of a dead agent when the program has some, and gives its own
+back when it dies instead of freeing them. The copies are rewound and initialized again but keep their other properties.
+*/
+class BehaviourTreeProgramState {
+public:
+	BehaviourTreeProgramState(std::shared_ptr<const BehaviourTreeProgram> program, BehaviourTree *owner, bool pooled = false);
+	~BehaviourTreeProgramState();
+
+	// When 'resume_running' is set, the tick starts from the path that was left running in the last tick
+	// instead of walking down from the root
+	NodeState Execute(bool resume_running = false);
+
+	// Called when a value of the owner's blackboard changed, observers of the slot are evaluated on the next execution.
+	// Returns true if the slot is observed
+	bool OnBlackboardChanged(uint32_t slot);
+
+	void ClearRunningPath() noexcept {
+		m_RunningDepth = 0;
+	}
+
+	// Clock time until which the last execution would keep returning running without doing anything,
+	// 0 when the tree has to be executed on every tick
+	uint64_t GetWakeTime() const noexcept {
+		return m_CanSleep && m_WakeTime != std::numeric_limits<uint64_t>::max() ? m_WakeTime : 0;
+	}
+
+	void InitializeNodes();
+
+	void Rewind() {
+		ClearRunningPath();
+		RewindRange(0, static_cast<uint32_t>(m_Program->m_Nodes.size()));
+	}
+
+	void RewindRange(uint32_t begin, uint32_t end);
+	void AbortRange(uint32_t begin, uint32_t end);
+
+	// Whether 'node' is the copy this state executes at 'index'
+	bool IsInstance(const IBehaviourTreeNodeBehaviour *node, uint32_t index) const noexcept {
+		return index < m_Program->m_Nodes.size() && m_Instances[index] == node;
+	}
+
+	NodeState GetState(uint32_t index) const noexcept {
+		return m_Instances[index] ? m_Instances[index]->GetState() : m_States.Get(index);
+	}
+
+	// Whether any node in [begin, end) is running
+	bool IsRunning(uint32_t begin, uint32_t end) const noexcept;
+
+	// States of the native nodes, the nodes executed through their object are inactive in it
+	const PackedNodeStates &GetPackedStates() const noexcept {
+		return m_States;
+	}
+
+	const std::shared_ptr<const BehaviourTreeProgram> &GetProgram() const noexcept {
+		return m_Program;
+	}
+
+private:
+	struct Frame {
+		uint32_t Index;
+		uint32_t Child;
+	};
+
+	union NodeScratch {
+		int32_t LoopCount;
+		// on the owner's clock
+		uint64_t Deadline;
+		// blackboard slot of the condition in the owner
+		uint32_t Slot;
+	};
+
+	void SetState(uint32_t index, NodeState state) noexcept {
+		if (m_Instances[index])
+			m_Instances[index]->SetState(state);
+		else
+			m_States.Set(index, state);
+	}
+
+	void InstantiateNodes(BehaviourTree *owner);
+	void ReuseNodes(BehaviourTree *owner);
+	void ResolveConditions();
+	void EnterNode(uint32_t index);
+	void UpdateWakeTime(uint32_t index, NodeState child_state);
+
+	bool CheckCondition(uint32_t index) const;
+	void ProcessObservers();
+	void EvaluateObserver(uint32_t index);
+
+private:
+	std::shared_ptr<const BehaviourTreeProgram> m_Program;
+	// the block, the per agent copies of the nodes that it keeps alive and the observers
+	BehaviourTreeProgramRuntime m_Runtime;
+	bool m_Pooled = false;
+
+	NodeScratch *m_Scratch = nullptr;
+	IBehaviourTreeNodeBehaviour **m_Instances = nullptr;
+	Frame *m_Stack = nullptr;
+	Frame *m_RunningPath = nullptr;
+	PackedNodeStates m_States;
+
+	uint32_t m_RunningDepth = 0;
+
+	// only the timers are running in the last execution, the tree can sleep until the first one
+	uint64_t m_WakeTime = 0;
+	bool m_CanSleep = false;
+
+	BehaviourTree *m_Owner = nullptr;
+};
+} //namespace behaviour_tree
@@ -1,9 +1,14 @@
 
 #include <algorithm>
+#include <map>
 #include <fstream>
 #include <sstream>
 #include <string>
 
+#include "factory.hpp"
+#include "buffer_reader.hpp"
+#include "buffer_writer.hpp"
+#include "file_mapping.hpp"
 #include "tree.hpp"
 
 #include "action_node.hpp"
@@ -12,6 +17,33 @@
 
 namespace behaviour_tree {
 /*
+Version 2, written by the current version:
+
+"BTRE"						magic												= 4 bytes
+2							version												= 2 bytes
+X							flags, 1 for _always_running						= 2 bytes
+X							index of root node + 1, 0 if it doesn't exists		= varint
+
+X							number of strings									= varint
+	"res://script.gd"		length and utf8 of the string						= varint + bytes
+	...
+
+X							number of node types								= varint
+	X						type id of the native node, 0 if it's not one		= 4 bytes
+	X						index of the class name in the strings				= varint
+	...
+
+X							number of nodes										= varint
+	X						index of the node's type							= varint
+	X						index of the script in the strings + 1, 0 if none	= varint
+	X						number of childrens									= varint
+	X ...					indices of childrens								= varint each
+	Variant					dictionary of the node's data						= variant
+
+	...
+
+Version 1, files without the magic:
+
 0 | 1						_always_running										= 1 byte
 X							index of root node, -1 if it doesn't exists			= 2 byte
 X							number of nodes										= 2 bytes
@@ -24,98 +56,146 @@ X							number of nodes										= 2 bytes
 
 	...
 */
+static constexpr uint8_t BTreeMagic[4] = { 'B', 'T', 'R', 'E' };
+static constexpr uint16_t BTreeVersion = 2;
+static constexpr uint16_t BTreeFlagAlwaysRunning = 1 << 0;
+
 struct NodeLoadInfo {
 	Ref<IBehaviourTreeNodeBehaviour> Node;
 	NodeType Type;
-	std::vector<uint16_t> Indices;
+	std::vector<uint32_t> Indices;
+	// set on the node once the dependencies of the whole tree are loaded,
+	// the script is its index in the scripts of the file + 1, 0 if none
+	uint32_t Script = 0;
+	Dictionary Data;
 };
 
 using NodeLoadInfoContainer = std::vector<NodeLoadInfo>;
 
-static NodeLoadInfoContainer LoadNodesFromFile(Ref<FileAccess> &file);
-static void SaveNodesToFile(const NodeLoadInfoContainer &loaded_nodes, Ref<FileAccess> &file);
+// How the nodes of a class are created, resolved once per class of a file instead of once per node
+struct NodeCreator {
+	const BehaviourTreeFactory::NodeTypeInfo *Native = nullptr;
+	StringName ClassName;
+	NodeType Type = NodeType::Action;
+	bool IsValid = false;
+};
+
+static Error LoadNodesFromFile(BufferReader &reader, NodeLoadInfoContainer &loaded_nodes, std::vector<String> &scripts);
+static Error LoadNodesFromFileV1(BufferReader &reader, NodeLoadInfoContainer &loaded_nodes, std::vector<String> &scripts);
+static void SaveNodesToFile(const NodeLoadInfoContainer &loaded_nodes, BufferWriter &writer);
 
+static void LoadNodesDependencies(NodeLoadInfoContainer &nodes, const std::vector<String> &scripts, const BehaviourTreeLoadOptions &options);
 static void ResolveNodesChildrensFromFile(NodeLoadInfoContainer &nodes);
 static void ResolveNodesIndicesForFile(NodeLoadInfoContainer &nodes);
 
-Error BehaviourTree::LoadFromFile(const String &path, Ref<FileAccess> file) {
-	Error err = Error::OK;
-	if (file.is_null())
-		file = FileAccess::open(path, FileAccess::READ, &err);
-
-	if (err != Error::OK || file->eof_reached()) {
+Error BehaviourTree::LoadFromFile(const String &path, const BehaviourTreeLoadOptions &options) {
+	// the whole file is mapped and parsed in place, it is only needed while the nodes are created
+	FileMapping mapping;
+	Error err = mapping.Open(path);
+	if (err != Error::OK)
 		return err;
-	}
-	try {
-		bool always_running = file->get_8();
-		uint16_t root_node_index = file->get_16();
 
-		NodeLoadInfoContainer loaded_nodes = LoadNodesFromFile(file);
-		ResolveNodesChildrensFromFile(loaded_nodes);
+	BufferReader reader(mapping.GetData(), mapping.GetSize());
+	return LoadFromBuffer(reader, options);
+}
 
-		auto &tree_nodes = GetNodes();
-		if (!loaded_nodes.empty()) {
-			if (root_node_index != std::numeric_limits<uint16_t>::max())
-				GDSetRootNodeIndex(root_node_index);
+Error BehaviourTree::LoadFromBuffer(BufferReader &reader, const BehaviourTreeLoadOptions &options) {
+	if (reader.IsEof())
+		return Error::OK;
 
-			tree_nodes.reserve(loaded_nodes.size());
-			for (auto &node : loaded_nodes)
-				tree_nodes.emplace_back(node.Node);
-		}
+	bool always_running = false;
+	uint32_t root_node_index = std::numeric_limits<uint32_t>::max();
+	NodeLoadInfoContainer loaded_nodes;
+	std::vector<String> scripts;
+	Error err = Error::OK;
+
+	const uint64_t start = reader.GetPosition();
+	uint8_t magic[sizeof(BTreeMagic)]{};
+	reader.GetBuffer(magic, sizeof(magic));
+
+	if (std::equal(std::begin(magic), std::end(magic), std::begin(BTreeMagic))) {
+		const uint16_t version = reader.Get16();
+		ERR_FAIL_COND_V_MSG(version > BTreeVersion, Error::ERR_FILE_UNRECOGNIZED, "Behaviour tree file of a newer version");
+
+		always_running = reader.Get16() & BTreeFlagAlwaysRunning;
+		root_node_index = reader.GetVarInt() - 1;
+		err = LoadNodesFromFile(reader, loaded_nodes, scripts);
+	} else {
+		reader.Seek(start);
+		always_running = reader.Get8();
+		const uint16_t index = reader.Get16();
+		if (index != std::numeric_limits<uint16_t>::max())
+			root_node_index = index;
+		err = LoadNodesFromFileV1(reader, loaded_nodes, scripts);
+	}
+	ERR_FAIL_COND_V_MSG(reader.HasError(), Error::ERR_FILE_CORRUPT, "Behaviour tree file is truncated");
+	if (err != Error::OK)
+		return err;
+	LoadNodesDependencies(loaded_nodes, scripts, options);
+	ResolveNodesChildrensFromFile(loaded_nodes);
 
-		SetAlwaysRunning(always_running);
-#if TOOLS_ENABLED
-	} catch (const std::exception &ex) {
-		ERR_PRINT(ex.what());
-#else
-	} catch (...) {
+	auto &tree_nodes = GetNodes();
+	if (!loaded_nodes.empty()) {
+		if (root_node_index < loaded_nodes.size())
+			GDSetRootNodeIndex(static_cast<int>(root_node_index));
 
-#endif
-		err = file->get_error();
+		tree_nodes.reserve(loaded_nodes.size());
+		for (auto &node : loaded_nodes) {
+			node.Node->SetBehaviourTree(this);
+			tree_nodes.emplace_back(node.Node);
+		}
 	}
 
-	return err;
+	SetAlwaysRunning(always_running);
+	return Error::OK;
 }
 
-Error BehaviourTree::SaveToFile(const String &path, Ref<FileAccess> file) {
+Error BehaviourTree::SaveToFile(const String &path) {
+	// the file is serialized in memory and written in a single call
+	BufferWriter writer;
+	SaveToBuffer(writer);
+
 	Error err = Error::OK;
-	if (file.is_null())
-		file = FileAccess::open(path, FileAccess::WRITE, &err);
-
-	if (err == Error::OK) {
-		file->store_8(IsAlwaysRunning() ? 1 : 0);
-
-		auto tree_to_nodes_load_info = [this]() -> NodeLoadInfoContainer {
-			NodeLoadInfoContainer loaded_nodes;
-			auto &tree_nodes = GetNodes();
-
-			if (!tree_nodes.empty()) {
-				loaded_nodes.reserve(tree_nodes.size());
-				for (auto &cur_node : tree_nodes) {
-					NodeLoadInfo info{};
-					info.Node = cur_node;
-
-					if (Object::cast_to<IBehaviourTreeDecoratorNode>(*cur_node))
-						info.Type = NodeType::Decorator;
-					else if (Object::cast_to<IBehaviourTreeCompositeNode>(*cur_node))
-						info.Type = NodeType::Composite;
-					else
-						info.Type = NodeType::Action;
-
-					loaded_nodes.emplace_back(std::move(info));
-				}
+	Ref<FileAccess> file = FileAccess::open(path, FileAccess::WRITE, &err);
+	if (err != Error::OK)
+		return err;
+	return writer.Flush(file);
+}
+
+void BehaviourTree::SaveToBuffer(BufferWriter &writer) {
+	writer.StoreBuffer(BTreeMagic, sizeof(BTreeMagic));
+	writer.Store16(BTreeVersion);
+	writer.Store16(IsAlwaysRunning() ? BTreeFlagAlwaysRunning : 0);
+	writer.StoreVarInt(static_cast<uint32_t>(GDGetRootNodeIndex() + 1));
+
+	auto tree_to_nodes_load_info = [this]() -> NodeLoadInfoContainer {
+		NodeLoadInfoContainer loaded_nodes;
+		auto &tree_nodes = GetNodes();
+
+		if (!tree_nodes.empty()) {
+			loaded_nodes.reserve(tree_nodes.size());
+			for (auto &cur_node : tree_nodes) {
+				NodeLoadInfo info{};
+				info.Node = cur_node;
+
+				if (Object::cast_to<IBehaviourTreeDecoratorNode>(*cur_node))
+					info.Type = NodeType::Decorator;
+				else if (Object::cast_to<IBehaviourTreeCompositeNode>(*cur_node))
+					info.Type = NodeType::Composite;
+				else
+					info.Type = NodeType::Action;
+
+				loaded_nodes.emplace_back(std::move(info));
 			}
+		}
 
-			return loaded_nodes;
-		};
+		return loaded_nodes;
+	};
 
-		NodeLoadInfoContainer loaded_nodes = tree_to_nodes_load_info();
-		ResolveNodesIndicesForFile(loaded_nodes);
+	NodeLoadInfoContainer loaded_nodes = tree_to_nodes_load_info();
+	ResolveNodesIndicesForFile(loaded_nodes);
 
-		file->store_16(static_cast<uint16_t>(GDGetRootNodeIndex()));
-		SaveNodesToFile(loaded_nodes, file);
-	}
-	return err;
+	SaveNodesToFile(loaded_nodes, writer);
 }
 
 Ref<Resource> ResourceFormatLoaderBehaviourTree::load(
@@ -131,7 +211,7 @@ Ref<Resource> ResourceFormatLoaderBehaviourTree::load(
 	if (r_error)
 		*r_error = OK;
 
-	Error err = res->LoadFromFile(p_path);
+	Error err = res->LoadFromFile(p_path, { p_use_sub_threads, r_progress, p_cache_mode });
 	if (r_error)
 		*r_error = err;
 
@@ -164,43 +244,138 @@ void ResourceFormatSaverBehaviourTree::get_recognized_extensions(const Ref<Resou
 	r_extensions->push_back("btree");
 }
 
-NodeLoadInfoContainer LoadNodesFromFile(Ref<FileAccess> &file) {
-	uint16_t number_of_nodes = file->get_16();
+static NodeCreator ResolveNodeCreator(uint32_t type_id, const String &class_name) {
+	// native nodes are created without going through the ClassDB
+	NodeCreator creator;
+	if (type_id)
+		creator.Native = BehaviourTreeFactory::GetTypeInfo(type_id);
+	if (creator.Native == nullptr)
+		creator.Native = BehaviourTreeFactory::GetTypeInfo(StringName(class_name));
+
+	creator.ClassName = creator.Native ? creator.Native->ClassName : StringName(class_name);
+	creator.IsValid = creator.Native || ClassDB::is_parent_class(creator.ClassName, IBehaviourTreeNodeBehaviour::get_class_static());
+	ERR_FAIL_COND_V_MSG(!creator.IsValid, creator, "Invalid node name/script: " + class_name);
+
+	// the scripts of the nodes can't change their native base
+	if (ClassDB::is_parent_class(creator.ClassName, IBehaviourTreeDecoratorNode::get_class_static()))
+		creator.Type = NodeType::Decorator;
+	else if (ClassDB::is_parent_class(creator.ClassName, IBehaviourTreeCompositeNode::get_class_static()))
+		creator.Type = NodeType::Composite;
+	return creator;
+}
 
-	NodeLoadInfoContainer loaded_nodes;
-	loaded_nodes.reserve(static_cast<size_t>(number_of_nodes));
-	loaded_nodes.reserve(static_cast<size_t>(number_of_nodes));
+// Node of the class, or null if the class isn't a node
+static Ref<IBehaviourTreeNodeBehaviour> CreateNodeFromFile(const NodeCreator &creator) {
+	if (!creator.IsValid)
+		return nullptr;
+	if (creator.Native)
+		return creator.Native->Create();
 
-	for (uint16_t i = 0; i < number_of_nodes; i++) {
-		String node_cls_name = ReadStringFromFile(file);
-		String node_script = ReadStringFromFile(file);
+	Object *object = ClassDB::instantiate(creator.ClassName);
+	ERR_FAIL_COND_V_MSG(object == nullptr, nullptr, "Invalid node name/script");
 
-		Object *object = ClassDB::instantiate(node_cls_name);
-		ERR_CONTINUE_MSG(object == nullptr, "Invalid node name/script");
+	Ref<IBehaviourTreeNodeBehaviour> node = Object::cast_to<IBehaviourTreeNodeBehaviour>(object);
+	ERR_FAIL_COND_V_MSG(node.is_null(), nullptr, "Node is not of type IBehaviourTreeNodeBehaviour");
+	return node;
+}
 
-		Ref<IBehaviourTreeNodeBehaviour> node = Object::cast_to<IBehaviourTreeNodeBehaviour>(object);
+Error LoadNodesFromFile(BufferReader &reader, NodeLoadInfoContainer &loaded_nodes, std::vector<String> &scripts) {
+	// the counts are bound by the size of their elements, a corrupted one can't allocate more than the file holds
+	// the scripts of the nodes are indices in the strings
+	std::vector<String> &strings = scripts;
+	strings.resize(reader.GetVarCount(1));
+	for (String &string : strings)
+		string = reader.GetUtf8(reader.GetVarInt());
+
+	auto get_string = [&strings](uint32_t index) -> String {
+		ERR_FAIL_COND_V_MSG(index >= strings.size(), String(), "String index out of bounds for behaviour tree");
+		return strings[index];
+	};
+
+	// each type is resolved once, the nodes only index it
+	std::vector<NodeCreator> types(reader.GetVarCount(5));
+	for (NodeCreator &type : types) {
+		const uint32_t type_id = reader.Get32();
+		type = ResolveNodeCreator(type_id, get_string(reader.GetVarInt()));
+	}
 
-		ERR_CONTINUE_MSG(node == nullptr, "Node is not of type IBehaviourTreeNodeBehaviour");
+	// type, script, number of childrens and the type of the data
+	const uint32_t number_of_nodes = reader.GetVarCount(4);
+	loaded_nodes.reserve(number_of_nodes);
 
-		if (!node_script.is_empty()) {
-			Ref<Script> script = ResourceLoader::load(node_script);
-			if (script.is_valid())
-				object->set_script(script);
+	for (uint32_t i = 0; i < number_of_nodes; i++) {
+		const uint32_t type_index = reader.GetVarInt();
+		const uint32_t script_index = reader.GetVarInt();
+
+		NodeLoadInfo info{};
+		info.Indices.resize(reader.GetVarCount(1));
+		for (uint32_t &index : info.Indices)
+			index = reader.GetVarInt();
+
+		{
+			Variant var = reader.GetVariant();
+			if (var.get_type() == Variant::DICTIONARY)
+				info.Data = var;
 		}
 
-		NodeType type = NodeType::Action;
-		if (Object::cast_to<IBehaviourTreeDecoratorNode>(*node))
-			type = NodeType::Decorator;
-		else if (Object::cast_to<IBehaviourTreeCompositeNode>(*node))
-			type = NodeType::Composite;
+		if (reader.HasError())
+			return Error::ERR_FILE_CORRUPT;
+
+		// the indices of the childrens would be off without the node, the whole tree fails
+		ERR_FAIL_COND_V_MSG(type_index >= types.size(), Error::ERR_FILE_CORRUPT, "Node type index out of bounds for behaviour tree");
+		info.Node = CreateNodeFromFile(types[type_index]);
+		ERR_FAIL_COND_V(info.Node.is_null(), Error::ERR_PARSE_ERROR);
+
+		info.Type = types[type_index].Type;
+		if (info.Type == NodeType::Action)
+			info.Indices.clear();
+
+		ERR_FAIL_COND_V_MSG(script_index > strings.size(), Error::ERR_FILE_CORRUPT, "Script index out of bounds for behaviour tree");
+		if (script_index && !strings[script_index - 1].is_empty())
+			info.Script = script_index;
+
+		loaded_nodes.emplace_back(std::move(info));
+	}
+
+	return Error::OK;
+}
+
+Error LoadNodesFromFileV1(BufferReader &reader, NodeLoadInfoContainer &loaded_nodes, std::vector<String> &scripts) {
+	uint16_t number_of_nodes = reader.Get16();
+
+	loaded_nodes.reserve(static_cast<size_t>(number_of_nodes));
+
+	// the names are repeated for each node, they are resolved the first time they are seen
+	std::map<String, NodeCreator> creators;
+	std::map<String, uint32_t> script_indices;
+
+	for (uint16_t i = 0; i < number_of_nodes; i++) {
+		String node_cls_name = reader.GetString();
+		String node_script = reader.GetString();
+
+		auto creator = creators.find(node_cls_name);
+		if (creator == creators.end())
+			creator = creators.emplace(node_cls_name, ResolveNodeCreator(0, node_cls_name)).first;
+
+		// the rest of the node can't be skipped, the whole tree fails
+		Ref<IBehaviourTreeNodeBehaviour> node = CreateNodeFromFile(creator->second);
+		ERR_FAIL_COND_V(node.is_null(), Error::ERR_PARSE_ERROR);
+
+		NodeType type = creator->second.Type;
 
 		NodeLoadInfo info{};
 		info.Node = node;
 		info.Type = type;
+		if (!node_script.is_empty()) {
+			auto [script, inserted] = script_indices.emplace(node_script, static_cast<uint32_t>(scripts.size() + 1));
+			if (inserted)
+				scripts.push_back(node_script);
+			info.Script = script->second;
+		}
 
 		uint16_t idx;
 		while (true) {
-			idx = file->get_16();
+			idx = reader.Get16();
 			if (idx == std::numeric_limits<uint16_t>::max())
 				break;
 
@@ -213,41 +388,155 @@ NodeLoadInfoContainer LoadNodesFromFile(Ref<FileAccess> &file) {
 			}
 		}
 
-		Dictionary dict;
 		{
-			Variant var = ReadVariantFromFile(file);
+			Variant var = reader.GetVariant();
 			if (var.get_type() == Variant::DICTIONARY)
-				dict = var;
+				info.Data = var;
 		}
 
-		if (!dict.is_empty())
-			node->DeserializeNode(dict);
-
 		loaded_nodes.emplace_back(std::move(info));
 	}
 
-	return loaded_nodes;
+	return Error::OK;
 }
 
-void SaveNodesToFile(const NodeLoadInfoContainer &loaded_nodes, Ref<FileAccess> &file) {
-	file->store_16(static_cast<uint16_t>(loaded_nodes.size()));
+void SaveNodesToFile(const NodeLoadInfoContainer &loaded_nodes, BufferWriter &writer) {
+	// strings and types are written once, the nodes refer to them by index
+	std::vector<String> strings;
+	std::map<String, uint32_t> string_indices;
+	auto add_string = [&](const String &string) -> uint32_t {
+		auto [iter, inserted] = string_indices.emplace(string, static_cast<uint32_t>(strings.size()));
+		if (inserted)
+			strings.push_back(string);
+		return iter->second;
+	};
+
+	std::vector<StringName> types;
+	std::map<StringName, uint32_t> type_indices;
+	std::vector<uint32_t> node_types, node_scripts;
+	node_types.reserve(loaded_nodes.size());
+	node_scripts.reserve(loaded_nodes.size());
 
 	for (auto &cur_node : loaded_nodes) {
-		WriteStringToFile(file, cur_node.Node->get_class_name());
+		const StringName class_name = cur_node.Node->get_class_name();
+		auto [iter, inserted] = type_indices.emplace(class_name, static_cast<uint32_t>(types.size()));
+		if (inserted)
+			types.push_back(class_name);
+		node_types.push_back(iter->second);
+
 		Ref<Script> script = cur_node.Node->get_script();
-		String file_path;
-		if (script.is_valid())
-			file_path = script->get_path();
-		WriteStringToFile(file, file_path);
+		const String script_path = script.is_valid() ? script->get_path() : String();
+		node_scripts.push_back(script_path.is_empty() ? 0 : add_string(script_path) + 1);
+	}
 
-		for (uint16_t idx : cur_node.Indices)
-			file->store_16(idx);
-		file->store_16(std::numeric_limits<uint16_t>::max());
+	std::vector<uint32_t> type_names;
+	type_names.reserve(types.size());
+	for (const StringName &type : types)
+		type_names.push_back(add_string(type));
+
+	writer.StoreVarInt(static_cast<uint32_t>(strings.size()));
+	for (const String &string : strings) {
+		CharString cs = string.utf8();
+		writer.StoreVarInt(static_cast<uint32_t>(cs.length()));
+		writer.StoreBuffer(reinterpret_cast<const uint8_t *>(cs.ptr()), cs.length());
+	}
+
+	writer.StoreVarInt(static_cast<uint32_t>(types.size()));
+	for (size_t i = 0; i < types.size(); i++) {
+		writer.Store32(BehaviourTreeFactory::GetTypeId(types[i]));
+		writer.StoreVarInt(type_names[i]);
+	}
+
+	writer.StoreVarInt(static_cast<uint32_t>(loaded_nodes.size()));
+	for (size_t i = 0; i < loaded_nodes.size(); i++) {
+		auto &cur_node = loaded_nodes[i];
+		writer.StoreVarInt(node_types[i]);
+		writer.StoreVarInt(node_scripts[i]);
+
+		writer.StoreVarInt(static_cast<uint32_t>(cur_node.Indices.size()));
+		for (uint32_t idx : cur_node.Indices)
+			writer.StoreVarInt(idx);
 
 		Dictionary out_data;
 		cur_node.Node->SerializeNode(out_data);
-		WriteVariantToFile(file, out_data);
+		writer.StoreVariant(out_data);
+	}
+}
+
+void LoadNodesDependencies(NodeLoadInfoContainer &loaded_nodes, const std::vector<String> &scripts, const BehaviourTreeLoadOptions &options) {
+	// the dependencies are shared through the cache unless the tree itself is loaded without it
+	const bool use_cache = options.CacheMode != ResourceFormatLoader::CACHE_MODE_IGNORE;
+	const ResourceFormatLoader::CacheMode cache_mode = use_cache ? ResourceFormatLoader::CACHE_MODE_REUSE : ResourceFormatLoader::CACHE_MODE_IGNORE;
+
+	struct Dependency {
+		String Path;
+		Ref<Resource> Loaded;
+		bool Requested = false;
+	};
+	std::vector<Dependency> dependencies;
+	std::map<String, size_t> dependency_indices;
+	auto add_dependency = [&](const String &path) -> size_t {
+		auto [iter, inserted] = dependency_indices.emplace(path, dependencies.size());
+		if (inserted)
+			dependencies.push_back(Dependency{ path });
+		return iter->second;
+	};
+
+	// each script of the file is looked up once, however many nodes use it
+	constexpr size_t NoDependency = std::numeric_limits<size_t>::max();
+	std::vector<size_t> script_dependencies(scripts.size(), NoDependency);
+
+	std::vector<String> node_dependencies;
+	for (auto &info : loaded_nodes) {
+		if (info.Script) {
+			size_t &dependency = script_dependencies[info.Script - 1];
+			if (dependency == NoDependency)
+				dependency = add_dependency(scripts[info.Script - 1]);
+		}
+
+		// the nodes load their own resources through the cache, they only find them there if it is used
+		if (use_cache && !info.Data.is_empty()) {
+			node_dependencies.clear();
+			info.Node->GetDependencies(info.Data, node_dependencies);
+			for (const String &path : node_dependencies)
+				add_dependency(path);
+		}
+	}
+
+	// all requested before waiting on any, they load in parallel on the loader's threads
+	if (options.UseSubThreads && use_cache) {
+		for (Dependency &dependency : dependencies)
+			dependency.Requested = ResourceLoader::load_threaded_request(dependency.Path, "", true) == Error::OK;
+	}
+
+	for (size_t i = 0; i < dependencies.size(); i++) {
+		Dependency &dependency = dependencies[i];
+		if (dependency.Requested)
+			dependency.Loaded = ResourceLoader::load_threaded_get(dependency.Path);
+		else
+			dependency.Loaded = ResourceLoader::load(dependency.Path, "", cache_mode);
+
+		// the last step is the deserialization of the nodes
+		if (options.Progress)
+			*options.Progress = static_cast<float>(i + 1) / static_cast<float>(dependencies.size() + 1);
+	}
+
+	std::vector<Ref<Script>> loaded_scripts(scripts.size());
+	for (size_t i = 0; i < scripts.size(); i++) {
+		if (script_dependencies[i] != NoDependency)
+			loaded_scripts[i] = dependencies[script_dependencies[i]].Loaded;
 	}
+
+	for (auto &info : loaded_nodes) {
+		if (info.Script && loaded_scripts[info.Script - 1].is_valid())
+			info.Node->set_script(loaded_scripts[info.Script - 1]);
+
+		if (!info.Data.is_empty())
+			info.Node->DeserializeNode(info.Data);
+	}
+
+	if (options.Progress)
+		*options.Progress = 1.0f;
 }
 
 void ResolveNodesChildrensFromFile(NodeLoadInfoContainer &loaded_nodes) {
@@ -256,25 +545,21 @@ void ResolveNodesChildrensFromFile(NodeLoadInfoContainer &loaded_nodes) {
 			continue;
 		switch (node_info->Type) {
 			case NodeType::Decorator: {
-				int node_index = node_info->Indices[0];
-				ERR_CONTINUE_MSG(node_index >= static_cast<int>(loaded_nodes.size()), "Index out of bounds for behaviour tree");
+				uint32_t node_index = node_info->Indices[0];
+				ERR_CONTINUE_MSG(node_index >= loaded_nodes.size(), "Index out of bounds for behaviour tree");
 
-				if (node_index != -1) {
-					IBehaviourTreeNodeBehaviour *child = *loaded_nodes[node_index].Node;
-					IBehaviourTreeDecoratorNode *parent = Object::cast_to<IBehaviourTreeDecoratorNode>(*node_info->Node);
+				IBehaviourTreeNodeBehaviour *child = *loaded_nodes[node_index].Node;
+				IBehaviourTreeDecoratorNode *parent = Object::cast_to<IBehaviourTreeDecoratorNode>(*node_info->Node);
 
-					parent->SetChild(child);
-				}
+				parent->SetChild(child);
 				break;
 			}
 			case NodeType::Composite: {
 				IBehaviourTreeCompositeNode *parent = Object::cast_to<IBehaviourTreeCompositeNode>(*node_info->Node);
-				for (int node_index : node_info->Indices) {
-					ERR_CONTINUE_MSG(node_index >= static_cast<int>(loaded_nodes.size()), "Index out of bounds for behaviour tree");
-					if (node_index != -1) {
-						IBehaviourTreeNodeBehaviour *child = *loaded_nodes[node_index].Node;
-						parent->AddChild(child);
-					}
+				for (uint32_t node_index : node_info->Indices) {
+					ERR_CONTINUE_MSG(node_index >= loaded_nodes.size(), "Index out of bounds for behaviour tree");
+					IBehaviourTreeNodeBehaviour *child = *loaded_nodes[node_index].Node;
+					parent->AddChild(child);
 				}
 				break;
 			}
@@ -289,10 +574,7 @@ void ResolveNodesIndicesForFile(NodeLoadInfoContainer &loaded_nodes) {
 		switch (cur_node.Type) {
 			case NodeType::Decorator:
 			case NodeType::Composite: {
-				std::vector<IBehaviourTreeNodeBehaviour *> childrens;
-				cur_node.Node->GetChildrens(childrens);
-
-				for (IBehaviourTreeNodeBehaviour *child : childrens) {
+				for (IBehaviourTreeNodeBehaviour *child : cur_node.Node->GetChildrens()) {
 					for (size_t j = 0; j < loaded_nodes.size(); j++) {
 						if (loaded_nodes[j].Node == child) {
 							cur_node.Indices.push_back(j);
@@ -306,507 +588,4 @@ void ResolveNodesIndicesForFile(NodeLoadInfoContainer &loaded_nodes) {
 	}
 }
 
-void WriteStringToFile(Ref<FileAccess> &file, const String &key) {
-	if (key.is_empty()) {
-		file->store_32(0);
-		file->store_8(0);
-	} else
-		file->store_pascal_string(key);
-}
-
-void WriteVariantToFile(Ref<FileAccess> &file, const Variant &var) {
-	file->store_8(var.get_type());
-	switch (var.get_type()) {
-		case Variant::BOOL:
-			file->store_8(var.operator bool());
-			break;
-		case Variant::INT:
-			file->store_32(var.operator int());
-			break;
-		case Variant::FLOAT:
-			file->store_float(var);
-			break;
-		case Variant::STRING:
-			WriteStringToFile(file, var);
-			break;
-
-		case Variant::VECTOR2: {
-			Vector2 val = var;
-			file->store_buffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
-			break;
-		}
-		case Variant::VECTOR2I: {
-			Vector2i val = var;
-			file->store_buffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
-			break;
-		}
-		case Variant::RECT2: {
-			Rect2 val = var;
-			file->store_buffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
-			break;
-		}
-		case Variant::RECT2I: {
-			Rect2i val = var;
-			file->store_buffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
-			break;
-		}
-		case Variant::VECTOR3: {
-			Vector3 val = var;
-			file->store_buffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
-			break;
-		}
-		case Variant::VECTOR3I: {
-			Vector3i val = var;
-			file->store_buffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
-			break;
-		}
-		case Variant::TRANSFORM2D: {
-			Transform2D val = var;
-			file->store_buffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
-			break;
-		}
-		case Variant::VECTOR4: {
-			Vector4 val = var;
-			file->store_buffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
-			break;
-		}
-		case Variant::VECTOR4I: {
-			Vector4i val = var;
-			file->store_buffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
-			break;
-		}
-		case Variant::PLANE: {
-			Plane val = var;
-			file->store_buffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
-			break;
-		}
-		case Variant::QUATERNION: {
-			Quaternion val = var;
-			file->store_buffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
-			break;
-		}
-		case Variant::AABB: {
-			AABB val = var;
-			file->store_buffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
-			break;
-		}
-		case Variant::BASIS: {
-			Basis val = var;
-			file->store_buffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
-			break;
-		}
-		case Variant::TRANSFORM3D: {
-			Transform3D val = var;
-			file->store_buffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
-			break;
-		}
-		case Variant::PROJECTION: {
-			Projection val = var;
-			file->store_buffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
-			break;
-		}
-
-		// misc types
-		case Variant::COLOR: {
-			Color color = var;
-			file->store_buffer(reinterpret_cast<const uint8_t *>(&color), sizeof(color));
-			break;
-		}
-		case Variant::STRING_NAME: {
-			WriteStringToFile(file, var);
-			break;
-		}
-		case Variant::NODE_PATH: {
-			NodePath val = var;
-			WriteStringToFile(file, val);
-			break;
-		}
-		case Variant::RID: {
-			RID val = var;
-			file->store_buffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
-			break;
-		}
-		case Variant::OBJECT: {
-			Object *val = var;
-			file->store_64(val->get_instance_id());
-			break;
-		}
-		case Variant::CALLABLE: {
-			Callable val = var;
-			ERR_FAIL_COND_MSG(val.is_custom() || val.is_null(), "Invalid Callable passed in Variant");
-			file->store_buffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
-			break;
-		}
-		case Variant::SIGNAL: {
-			Signal val = var;
-			file->store_buffer(reinterpret_cast<const uint8_t *>(&val), sizeof(val));
-			break;
-		}
-		case Variant::DICTIONARY: {
-			Dictionary val = var;
-			auto keys = val.keys();
-			auto vals = val.values();
-			file->store_32(val.size());
-			for (int i = 0; i < val.size(); i++) {
-				WriteVariantToFile(file, keys[i]);
-				WriteVariantToFile(file, vals[i]);
-			}
-			break;
-		}
-		case Variant::ARRAY: {
-			Array val = var;
-			file->store_32(val.size());
-			for (int i = 0; i < val.size(); i++)
-				WriteVariantToFile(file, val[i]);
-			break;
-		}
-
-		// typed arrays
-		case Variant::PACKED_BYTE_ARRAY: {
-			PackedByteArray val = var;
-			file->store_32(val.size());
-			for (int i = 0; i < val.size(); i++)
-				file->store_8(val[i]);
-			break;
-		}
-		case Variant::PACKED_INT32_ARRAY: {
-			PackedInt32Array val = var;
-			file->store_32(val.size());
-			for (int i = 0; i < val.size(); i++)
-				file->store_32(val[i]);
-			break;
-		}
-		case Variant::PACKED_INT64_ARRAY: {
-			PackedInt64Array val = var;
-			file->store_32(val.size());
-			for (int i = 0; i < val.size(); i++)
-				file->store_64(val[i]);
-			break;
-		}
-		case Variant::PACKED_FLOAT32_ARRAY: {
-			PackedFloat32Array val = var;
-			file->store_32(val.size());
-			for (int i = 0; i < val.size(); i++)
-				file->store_float(val[i]);
-			break;
-		}
-		case Variant::PACKED_FLOAT64_ARRAY: {
-			PackedFloat64Array val = var;
-			file->store_32(val.size());
-			for (int i = 0; i < val.size(); i++)
-				file->store_double(val[i]);
-			break;
-		}
-		case Variant::PACKED_STRING_ARRAY: {
-			PackedStringArray val = var;
-			file->store_32(val.size());
-			for (int i = 0; i < val.size(); i++)
-				WriteStringToFile(file, val[i]);
-			break;
-		}
-		case Variant::PACKED_VECTOR2_ARRAY: {
-			PackedVector2Array val = var;
-			file->store_32(val.size());
-			for (int i = 0; i < val.size(); i++) {
-				file->store_float(val[i].x);
-				file->store_float(val[i].y);
-			}
-			break;
-		}
-		case Variant::PACKED_VECTOR3_ARRAY: {
-			PackedVector3Array val = var;
-			file->store_32(val.size());
-			for (int i = 0; i < val.size(); i++) {
-				file->store_float(val[i].x);
-				file->store_float(val[i].y);
-				file->store_float(val[i].z);
-			}
-			break;
-		}
-		case Variant::PACKED_COLOR_ARRAY: {
-			PackedColorArray val = var;
-			file->store_32(val.size());
-			for (int i = 0; i < val.size(); i++) {
-				file->store_float(val[i].r);
-				file->store_float(val[i].g);
-				file->store_float(val[i].b);
-				file->store_float(val[i].a);
-			}
-			break;
-		}
-
-		default: {
-			ERR_FAIL_COND_MSG(var.get_type() == Variant::NIL || var.is_null(), "Invalid variant in Behaviour Tree");
-		}
-	}
-}
-
-String ReadStringFromFile(Ref<FileAccess> &file) {
-	uint32_t len = file->get_32();
-	String str = "";
-
-	if (!len) {
-		[[maybe_unused]] char dummy = file->get_8();
-	} else {
-		CharString cs;
-		cs.resize(len + 1);
-		file->get_buffer((uint8_t *)cs.ptr(), len);
-		cs[len] = 0;
-
-		str.parse_utf8(cs.ptr(), cs.size());
-	}
-	return str;
-}
-
-Variant ReadVariantFromFile(Ref<FileAccess> &file) {
-	switch (file->get_8()) {
-		case Variant::BOOL:
-			return static_cast<bool>(file->get_8());
-			break;
-		case Variant::INT:
-			return static_cast<int>(file->get_32());
-			break;
-		case Variant::FLOAT:
-			return static_cast<float>(file->get_float());
-			break;
-		case Variant::STRING:
-			return ReadStringFromFile(file);
-			break;
-
-		case Variant::VECTOR2: {
-			Vector2 val;
-			file->get_buffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
-			return val;
-		}
-		case Variant::VECTOR2I: {
-			Vector2i val;
-			file->get_buffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
-			return val;
-		}
-		case Variant::RECT2: {
-			Rect2 val;
-			file->get_buffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
-			return val;
-		}
-		case Variant::RECT2I: {
-			Rect2i val;
-			file->get_buffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
-			return val;
-		}
-		case Variant::VECTOR3: {
-			Vector3 val;
-			file->get_buffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
-			return val;
-		}
-		case Variant::VECTOR3I: {
-			Vector3i val;
-			file->get_buffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
-			return val;
-		}
-		case Variant::TRANSFORM2D: {
-			Transform2D val;
-			file->get_buffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
-			return val;
-		}
-		case Variant::VECTOR4: {
-			Vector4 val;
-			file->get_buffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
-			return val;
-		}
-		case Variant::VECTOR4I: {
-			Vector4i val;
-			file->get_buffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
-			return val;
-		}
-		case Variant::PLANE: {
-			Plane val;
-			file->get_buffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
-			return val;
-		}
-		case Variant::QUATERNION: {
-			Quaternion val;
-			file->get_buffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
-			return val;
-		}
-		case Variant::AABB: {
-			AABB val;
-			file->get_buffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
-			return val;
-		}
-		case Variant::BASIS: {
-			Basis val;
-			file->get_buffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
-			return val;
-		}
-		case Variant::TRANSFORM3D: {
-			Transform3D val;
-			file->get_buffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
-			return val;
-		}
-		case Variant::PROJECTION: {
-			Projection val;
-			file->get_buffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
-			return val;
-		}
-
-		// misc types
-		case Variant::COLOR: {
-			Color val;
-			file->get_buffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
-			return val;
-		}
-		case Variant::STRING_NAME: {
-			return ReadStringFromFile(file);
-			break;
-		}
-		case Variant::NODE_PATH: {
-			return NodePath(ReadStringFromFile(file));
-		}
-		case Variant::RID: {
-			RID val;
-			file->get_buffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
-			return val;
-		}
-		case Variant::OBJECT: {
-			Object *val = ObjectDB::get_instance(ObjectID(file->get_64()));
-			if (!val)
-				ERR_PRINT("Invalid Object passed in Variant");
-			return val;
-		}
-		case Variant::CALLABLE: {
-			Callable val;
-			file->get_buffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
-			if (val.is_custom() || val.is_null())
-				ERR_PRINT("Invalid Callable passed in Variant");
-			return val;
-		}
-		case Variant::SIGNAL: {
-			Signal val;
-			file->get_buffer(reinterpret_cast<uint8_t *>(&val), sizeof(val));
-			return val;
-		}
-		case Variant::DICTIONARY: {
-			Dictionary val;
-			int size = file->get_32();
-			for (int i = 0; i < size; i++) {
-				Variant key = ReadVariantFromFile(file);
-				Variant value = ReadVariantFromFile(file);
-				val[key] = value;
-			}
-			return val;
-		}
-		case Variant::ARRAY: {
-			Array val;
-			int size = file->get_32();
-			val.resize(size);
-
-			for (int i = 0; i < size; i++)
-				val[i] = ReadVariantFromFile(file);
-			return val;
-		}
-
-		// typed arrays
-		case Variant::PACKED_BYTE_ARRAY: {
-			PackedByteArray val;
-			int size = file->get_32();
-
-			for (int i = 0; i < size; i++)
-				val.append(file->get_8());
-
-			return val;
-		}
-		case Variant::PACKED_INT32_ARRAY: {
-			PackedInt32Array val;
-			int size = file->get_32();
-
-			for (int i = 0; i < size; i++)
-				val.append(file->get_32());
-
-			return val;
-		}
-		case Variant::PACKED_INT64_ARRAY: {
-			PackedInt64Array val;
-			int size = file->get_32();
-
-			for (int i = 0; i < size; i++)
-				val.append(file->get_64());
-
-			return val;
-		}
-		case Variant::PACKED_FLOAT32_ARRAY: {
-			PackedFloat32Array val;
-			int size = file->get_32();
-
-			for (int i = 0; i < size; i++)
-				val.append(file->get_float());
-
-			return val;
-		}
-		case Variant::PACKED_FLOAT64_ARRAY: {
-			PackedFloat64Array val;
-			int size = file->get_32();
-
-			for (int i = 0; i < size; i++)
-				val.append(file->get_double());
-
-			return val;
-		}
-		case Variant::PACKED_STRING_ARRAY: {
-			PackedStringArray val;
-			int size = file->get_32();
-
-			for (int i = 0; i < size; i++)
-				val.append(ReadStringFromFile(file));
-
-			return val;
-		}
-		case Variant::PACKED_VECTOR2_ARRAY: {
-			PackedVector2Array val;
-			int size = file->get_32();
-
-			for (int i = 0; i < size; i++) {
-				Vector2 vec;
-				vec.x = file->get_float();
-				vec.y = file->get_float();
-				val.append(vec);
-			}
-
-			return val;
-		}
-		case Variant::PACKED_VECTOR3_ARRAY: {
-			PackedVector3Array val;
-			int size = file->get_32();
-
-			for (int i = 0; i < size; i++) {
-				Vector3 vec;
-				vec.x = file->get_float();
-				vec.y = file->get_float();
-				vec.z = file->get_float();
-				val.append(vec);
-			}
-
-			return val;
-		}
-		case Variant::PACKED_COLOR_ARRAY: {
-			PackedColorArray val;
-			int size = file->get_32();
-
-			for (int i = 0; i < size; i++) {
-				Color color;
-				color.r = file->get_float();
-				color.g = file->get_float();
-				color.b = file->get_float();
-				color.a = file->get_float();
-				val.append(color);
-			}
-
-			return val;
-		}
-
-		default: {
-			ERR_PRINT("Invalid variant in Behaviour Tree");
-			return Variant{};
-		}
-	}
-}
 } //namespace behaviour_tree
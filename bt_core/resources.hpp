@@ -1,5 +1,7 @@
 #pragma once
 
+#include "buffer_reader.hpp"
+#include "buffer_writer.hpp"
 #include "core/io/resource_loader.h"
 #include "core/io/resource_saver.h"
 #include <vector>
@@ -7,11 +9,12 @@
 namespace behaviour_tree {
 class IBehaviourTreeNodeBehaviour;
 
-void WriteStringToFile(Ref<FileAccess> &file, const String &key);
-void WriteVariantToFile(Ref<FileAccess> &file, const Variant &var);
-String ReadStringFromFile(Ref<FileAccess> &file);
-Variant ReadVariantFromFile(Ref<FileAccess> &file);
-
+// Arguments of ResourceFormatLoader::load, for the resources the nodes of a tree refer to
+struct BehaviourTreeLoadOptions {
+	bool UseSubThreads = false;
+	float *Progress = nullptr;
+	ResourceFormatLoader::CacheMode CacheMode = ResourceFormatLoader::CACHE_MODE_REUSE;
+};
 
 class ResourceFormatLoaderBehaviourTree : public ResourceFormatLoader {
 public:
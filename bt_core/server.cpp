@@ -0,0 +1,366 @@
+#include "server.hpp"
+#include "core/object/worker_thread_pool.h"
+#include "core/os/os.h"
+#include "scene/main/scene_tree.h"
+
+namespace behaviour_tree {
+void BehaviourTreeServer::_bind_methods() {
+	ClassDB::bind_method(D_METHOD("agent_create", "tree"), &BehaviourTreeServer::AgentCreate);
+
+	ClassDB::bind_method(D_METHOD("agent_set_tree", "agent", "tree"), &BehaviourTreeServer::AgentSetTree);
+	ClassDB::bind_method(D_METHOD("agent_get_tree", "agent"), &BehaviourTreeServer::AgentGetTree);
+
+	ClassDB::bind_method(D_METHOD("agent_set_tick_mode", "agent", "mode"), &BehaviourTreeServer::AgentSetTickMode);
+	ClassDB::bind_method(D_METHOD("agent_get_tick_mode", "agent"), &BehaviourTreeServer::AgentGetTickMode);
+
+	ClassDB::bind_method(D_METHOD("agent_set_tick_rate", "agent", "rate"), &BehaviourTreeServer::AgentSetTickRate);
+	ClassDB::bind_method(D_METHOD("agent_get_tick_rate", "agent"), &BehaviourTreeServer::AgentGetTickRate);
+
+	ClassDB::bind_method(D_METHOD("agent_set_active", "agent", "active"), &BehaviourTreeServer::AgentSetActive);
+	ClassDB::bind_method(D_METHOD("agent_is_active", "agent"), &BehaviourTreeServer::AgentIsActive);
+
+	ClassDB::bind_method(D_METHOD("agent_wake", "agent"), &BehaviourTreeServer::AgentWake);
+	ClassDB::bind_method(D_METHOD("agent_is_sleeping", "agent"), &BehaviourTreeServer::AgentIsSleeping);
+
+	ClassDB::bind_method(D_METHOD("free_rid", "rid"), &BehaviourTreeServer::FreeRid);
+	ClassDB::bind_method(D_METHOD("get_agents_count"), &BehaviourTreeServer::GetAgentsCount);
+
+	ClassDB::bind_method(D_METHOD("set_threaded", "threaded"), &BehaviourTreeServer::SetThreaded);
+	ClassDB::bind_method(D_METHOD("is_threaded"), &BehaviourTreeServer::IsThreaded);
+
+	ClassDB::bind_method(D_METHOD("set_frame_budget", "usec"), &BehaviourTreeServer::SetFrameBudget);
+	ClassDB::bind_method(D_METHOD("get_frame_budget"), &BehaviourTreeServer::GetFrameBudget);
+
+	BIND_ENUM_CONSTANT(TICK_MODE_IDLE);
+	BIND_ENUM_CONSTANT(TICK_MODE_PHYSICS);
+	BIND_ENUM_CONSTANT(TICK_MODE_MANUAL);
+
+	BIND_ENUM_CONSTANT(TICK_RATE_EVERY_FRAME);
+	BIND_ENUM_CONSTANT(TICK_RATE_EVERY_4TH_FRAME);
+	BIND_ENUM_CONSTANT(TICK_RATE_2HZ);
+}
+
+BehaviourTreeServer::BehaviourTreeServer() {
+	Singleton = this;
+}
+
+BehaviourTreeServer::~BehaviourTreeServer() {
+	Singleton = nullptr;
+}
+
+RID BehaviourTreeServer::AgentCreate(const Ref<BehaviourTree> &tree) {
+	ConnectToSceneTree();
+
+	Agent agent;
+	agent.Tree = tree;
+
+	RID rid = m_Agents.make_rid(agent);
+	m_Agents.get_or_null(rid)->Self = rid;
+	if (tree.is_valid())
+		tree->SetAgent(rid);
+
+	m_AgentsCount++;
+	UpdateTickList(rid);
+	return rid;
+}
+
+void BehaviourTreeServer::AgentSetTree(RID rid, const Ref<BehaviourTree> &tree) {
+	Agent *agent = m_Agents.get_or_null(rid);
+	ERR_FAIL_NULL(agent);
+
+	CancelSleep(agent);
+	if (agent->Tree.is_valid())
+		agent->Tree->SetAgent(RID());
+
+	agent->Tree = tree;
+	if (tree.is_valid())
+		tree->SetAgent(rid);
+	UpdateTickList(rid);
+}
+
+Ref<BehaviourTree> BehaviourTreeServer::AgentGetTree(RID rid) const {
+	Agent *agent = m_Agents.get_or_null(rid);
+	ERR_FAIL_NULL_V(agent, nullptr);
+	return agent->Tree;
+}
+
+void BehaviourTreeServer::AgentSetTickMode(RID rid, TickMode mode) {
+	ERR_FAIL_INDEX(mode, TICK_MODE_MANUAL + 1);
+	Agent *agent = m_Agents.get_or_null(rid);
+	ERR_FAIL_NULL(agent);
+
+	CancelSleep(agent);
+	agent->Mode = mode;
+	UpdateTickList(rid);
+}
+
+BehaviourTreeServer::TickMode BehaviourTreeServer::AgentGetTickMode(RID rid) const {
+	Agent *agent = m_Agents.get_or_null(rid);
+	ERR_FAIL_NULL_V(agent, TICK_MODE_MANUAL);
+	return agent->Mode;
+}
+
+void BehaviourTreeServer::AgentSetTickRate(RID rid, TickRate rate) {
+	ERR_FAIL_INDEX(rate, TICK_RATE_2HZ + 1);
+	Agent *agent = m_Agents.get_or_null(rid);
+	ERR_FAIL_NULL(agent);
+
+	agent->Rate = rate;
+}
+
+BehaviourTreeServer::TickRate BehaviourTreeServer::AgentGetTickRate(RID rid) const {
+	Agent *agent = m_Agents.get_or_null(rid);
+	ERR_FAIL_NULL_V(agent, TICK_RATE_EVERY_FRAME);
+	return agent->Rate;
+}
+
+void BehaviourTreeServer::AgentSetActive(RID rid, bool active) {
+	Agent *agent = m_Agents.get_or_null(rid);
+	ERR_FAIL_NULL(agent);
+
+	agent->Active = active;
+	UpdateTickList(rid);
+}
+
+bool BehaviourTreeServer::AgentIsActive(RID rid) const {
+	Agent *agent = m_Agents.get_or_null(rid);
+	ERR_FAIL_NULL_V(agent, false);
+	return agent->Active;
+}
+
+void BehaviourTreeServer::AgentWake(RID rid) {
+	// trees executed on the workers may write to the blackboard of a sleeping tree
+	if (m_IsTicking.is_set()) {
+		MutexLock lock(m_PendingWakesLock);
+		m_PendingWakes.push_back(rid);
+		return;
+	}
+
+	Agent *agent = m_Agents.get_or_null(rid);
+	if (agent && agent->Sleeping)
+		WakeAgent(agent);
+}
+
+bool BehaviourTreeServer::AgentIsSleeping(RID rid) const {
+	Agent *agent = m_Agents.get_or_null(rid);
+	ERR_FAIL_NULL_V(agent, false);
+	return agent->Sleeping;
+}
+
+void BehaviourTreeServer::FreeRid(RID rid) {
+	Agent *agent = m_Agents.get_or_null(rid);
+	ERR_FAIL_NULL(agent);
+
+	// the agent may be the one being ticked, it will be skipped until the tick is over
+	if (m_IsTicking.is_set()) {
+		agent->Active = false;
+		m_PendingFrees.push_back(rid);
+		return;
+	}
+
+	CancelSleep(agent);
+	if (agent->Tree.is_valid())
+		agent->Tree->SetAgent(RID());
+
+	RemoveFromTickList(agent);
+	m_Agents.free(rid);
+	m_AgentsCount--;
+}
+
+void BehaviourTreeServer::UpdateTickList(RID rid) {
+	if (m_IsTicking.is_set()) {
+		m_PendingUpdates.push_back(rid);
+		return;
+	}
+
+	Agent *agent = m_Agents.get_or_null(rid);
+	if (!agent)
+		return;
+
+	const TickMode list_mode = ShouldTick(agent) ? agent->Mode : TICK_MODE_MANUAL;
+	const bool woken = agent->Woken;
+	agent->Woken = false;
+	if (list_mode == agent->ListMode)
+		return;
+
+	RemoveFromTickList(agent);
+	if (list_mode != TICK_MODE_MANUAL) {
+		std::vector<Agent *> &list = m_TickLists[list_mode];
+		agent->ListMode = list_mode;
+		agent->ListIndex = list.size();
+
+		if (woken) {
+			// due right away, the tree gets the time it slept as its delta
+			agent->LastTickFrame = m_Frames[list_mode] - 4;
+		} else {
+			// due on the next frame, agents ticked every 4th frame are spread over the frames
+			agent->LastTickFrame = m_Frames[list_mode] - 1 - list.size() % 4;
+			agent->LastTickTime = m_Times[list_mode];
+		}
+		list.push_back(agent);
+	}
+}
+
+void BehaviourTreeServer::RemoveFromTickList(Agent *agent) {
+	if (agent->ListMode == TICK_MODE_MANUAL)
+		return;
+
+	std::vector<Agent *> &list = m_TickLists[agent->ListMode];
+	list[agent->ListIndex] = list.back();
+	list[agent->ListIndex]->ListIndex = agent->ListIndex;
+	list.pop_back();
+
+	agent->ListMode = TICK_MODE_MANUAL;
+}
+
+void BehaviourTreeServer::ConnectToSceneTree() {
+	if (m_IsConnected)
+		return;
+
+	SceneTree *scene_tree = SceneTree::get_singleton();
+	ERR_FAIL_NULL_MSG(scene_tree, "Behaviour trees can't be ticked without a scene tree");
+
+	scene_tree->connect("process_frame", callable_mp(this, &BehaviourTreeServer::TickAgents).bind(TICK_MODE_IDLE));
+	scene_tree->connect("physics_frame", callable_mp(this, &BehaviourTreeServer::TickAgents).bind(TICK_MODE_PHYSICS));
+	m_IsConnected = true;
+}
+
+bool BehaviourTreeServer::IsDue(const Agent *agent, TickMode mode) const noexcept {
+	switch (agent->Rate) {
+		case TICK_RATE_EVERY_4TH_FRAME:
+			return m_Frames[mode] - agent->LastTickFrame >= 4;
+		case TICK_RATE_2HZ:
+			return m_Times[mode] - agent->LastTickTime >= 0.5;
+		default:
+			return m_Frames[mode] != agent->LastTickFrame;
+	}
+}
+
+void BehaviourTreeServer::StartTick(Agent *agent, TickMode mode) {
+	// the agent gets the time elapsed since its last tick, including the frames it skipped
+	agent->Tree->SetTickDelta(m_Times[mode] - agent->LastTickTime);
+	agent->LastTickFrame = m_Frames[mode];
+	agent->LastTickTime = m_Times[mode];
+}
+
+void BehaviourTreeServer::ParkIfWaiting(Agent *agent, TickMode mode) {
+	const uint64_t wake_time = agent->Tree->GetWakeTime();
+	const uint64_t now = agent->Tree->GetClock().TimeUsec;
+	if (wake_time <= now)
+		return;
+
+	agent->Sleeping = true;
+	agent->SleepId++;
+	agent->Tree->SetSleeping(true);
+
+	// the clock of the tree advances with the time of the list
+	m_TimerWheels[mode].Schedule(TickClock::ToUsec(m_Times[mode]) + wake_time - now, { agent->Self, agent->SleepId });
+	UpdateTickList(agent->Self);
+}
+
+void BehaviourTreeServer::WakeAgent(Agent *agent) {
+	CancelSleep(agent);
+	agent->Woken = true;
+	UpdateTickList(agent->Self);
+}
+
+void BehaviourTreeServer::CancelSleep(Agent *agent) {
+	if (!agent->Sleeping)
+		return;
+
+	// the timer is ignored when it expires
+	agent->Sleeping = false;
+	agent->SleepId++;
+	if (agent->Tree.is_valid())
+		agent->Tree->SetSleeping(false);
+}
+
+void BehaviourTreeServer::TickAgents(TickMode mode) {
+	SceneTree *scene_tree = SceneTree::get_singleton();
+	m_Frames[mode]++;
+	m_Times[mode] += mode == TICK_MODE_PHYSICS ? scene_tree->get_physics_process_time() : scene_tree->get_process_time();
+
+	// agents whose timers expired are back in the list before it is ticked
+	m_TimerWheels[mode].Advance(TickClock::ToUsec(m_Times[mode]), [this](const Sleeper &sleeper) {
+		Agent *agent = m_Agents.get_or_null(sleeper.Agent);
+		if (agent && agent->Sleeping && agent->SleepId == sleeper.SleepId)
+			WakeAgent(agent);
+	});
+
+	m_IsTicking.set();
+	m_ThreadedAgents.clear();
+
+	// agents registered while ticking are added once the tick is over
+	std::vector<Agent *> &list = m_TickLists[mode];
+	const size_t count = list.size();
+	const size_t cursor = count ? m_Cursors[mode] % count : 0;
+	const uint64_t start_time = m_FrameBudgetUsec ? OS::get_singleton()->get_ticks_usec() : 0;
+
+	for (size_t i = 0; i < count; i++) {
+		const size_t index = (cursor + i) % count;
+		Agent *agent = list[index];
+		if (!ShouldTick(agent) || !IsDue(agent, mode))
+			continue;
+
+		// trees with nodes that must run on the main thread are executed right away, the rest is split across the workers
+		if (m_IsThreaded && agent->Tree->GetThreading() != NodeThreading::MainThread) {
+			StartTick(agent, mode);
+			agent->Tree->SetDeferringCalls(true);
+			m_ThreadedAgents.push_back(agent);
+			continue;
+		}
+
+		StartTick(agent, mode);
+		agent->Tree->ExecuteTree();
+		ParkIfWaiting(agent, mode);
+		if (m_FrameBudgetUsec && OS::get_singleton()->get_ticks_usec() - start_time >= m_FrameBudgetUsec) {
+			m_Cursors[mode] = index + 1;
+			break;
+		}
+	}
+
+	TickThreadedAgents(mode);
+
+	m_IsTicking.clear();
+	FlushPendingChanges();
+
+	BehaviourTreeProgram::TrimRuntimePools(PooledRuntimesFreedPerTick);
+}
+
+void BehaviourTreeServer::TickThreadedAgents(TickMode mode) {
+	if (m_ThreadedAgents.empty())
+		return;
+
+	WorkerThreadPool *thread_pool = WorkerThreadPool::get_singleton();
+	WorkerThreadPool::GroupID group = thread_pool->add_template_group_task(this, &BehaviourTreeServer::TickThreadedAgent, m_ThreadedAgents.data(), static_cast<int>(m_ThreadedAgents.size()), -1, true, SNAME("BehaviourTreeServer"));
+	thread_pool->wait_for_group_task_completion(group);
+
+	// sync point, apply the effects the trees queued in the order they were ticked
+	for (Agent *agent : m_ThreadedAgents) {
+		agent->Tree->SetDeferringCalls(false);
+		agent->Tree->FlushDeferredCalls();
+		ParkIfWaiting(agent, mode);
+	}
+}
+
+void BehaviourTreeServer::TickThreadedAgent(uint32_t index, Agent **agents) {
+	agents[index]->Tree->ExecuteTree();
+}
+
+void BehaviourTreeServer::FlushPendingChanges() {
+	{
+		MutexLock lock(m_PendingWakesLock);
+		for (RID rid : m_PendingWakes)
+			AgentWake(rid);
+		m_PendingWakes.clear();
+	}
+
+	for (RID rid : m_PendingFrees)
+		FreeRid(rid);
+	m_PendingFrees.clear();
+
+	for (RID rid : m_PendingUpdates)
+		UpdateTickList(rid);
+	m_PendingUpdates.clear();
+}
+} //namespace behaviour_tree
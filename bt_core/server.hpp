@@ -0,0 +1,163 @@
+#pragma once
+
+#include "tree.hpp"
+#include "timer_wheel.hpp"
+#include "core/os/mutex.h"
+#include "core/templates/safe_refcount.h"
+#include "core/templates/rid_owner.h"
+
+#include <vector>
+
+namespace behaviour_tree {
+// Owns the running trees of the scene and ticks them in one pass on each idle or physics frame
+class BehaviourTreeServer : public Object {
+	GDCLASS(BehaviourTreeServer, Object);
+
+public:
+	enum TickMode {
+		TICK_MODE_IDLE,
+		TICK_MODE_PHYSICS,
+		// registered but executed by its owner with 'execute_tree'
+		TICK_MODE_MANUAL,
+	};
+
+	enum TickRate {
+		TICK_RATE_EVERY_FRAME,
+		TICK_RATE_EVERY_4TH_FRAME,
+		TICK_RATE_2HZ,
+	};
+
+	static void _bind_methods();
+
+	static BehaviourTreeServer *get_singleton() noexcept {
+		return Singleton;
+	}
+
+	BehaviourTreeServer();
+	~BehaviourTreeServer();
+
+public:
+	RID AgentCreate(const Ref<BehaviourTree> &tree);
+
+	void AgentSetTree(RID agent, const Ref<BehaviourTree> &tree);
+	Ref<BehaviourTree> AgentGetTree(RID agent) const;
+
+	void AgentSetTickMode(RID agent, TickMode mode);
+	TickMode AgentGetTickMode(RID agent) const;
+
+	void AgentSetTickRate(RID agent, TickRate rate);
+	TickRate AgentGetTickRate(RID agent) const;
+
+	void AgentSetActive(RID agent, bool active);
+	bool AgentIsActive(RID agent) const;
+
+	// Agents whose trees only wait on timers are parked until the first timer expires, this wakes one up early
+	void AgentWake(RID agent);
+	bool AgentIsSleeping(RID agent) const;
+
+	void FreeRid(RID rid);
+
+	int GetAgentsCount() const noexcept {
+		return static_cast<int>(m_AgentsCount);
+	}
+
+	// Agents whose nodes can run off the main thread are ticked in parallel on the WorkerThreadPool
+	void SetThreaded(bool threaded) noexcept {
+		m_IsThreaded = threaded;
+	}
+	bool IsThreaded() const noexcept {
+		return m_IsThreaded;
+	}
+
+	// Time the main thread can spend ticking agents each frame, agents left are ticked first on the next frame.
+	// 0 disables the budget
+	void SetFrameBudget(int usec) noexcept {
+		m_FrameBudgetUsec = usec;
+	}
+	int GetFrameBudget() const noexcept {
+		return static_cast<int>(m_FrameBudgetUsec);
+	}
+
+private:
+	struct Agent {
+		RID Self;
+		Ref<BehaviourTree> Tree;
+		TickMode Mode = TICK_MODE_IDLE;
+		TickRate Rate = TICK_RATE_EVERY_FRAME;
+		bool Active = true;
+
+		// parked until its timer expires, timers of the previous sleeps are told apart by their id
+		bool Sleeping = false;
+		bool Woken = false;
+		uint32_t SleepId = 0;
+
+		// frame and time of the tick list when the agent was last ticked
+		uint64_t LastTickFrame = 0;
+		double LastTickTime = 0.0;
+
+		// tick list the agent is in, or TICK_MODE_MANUAL if it isn't ticked by the server
+		TickMode ListMode = TICK_MODE_MANUAL;
+		size_t ListIndex = 0;
+	};
+
+	bool ShouldTick(const Agent *agent) const noexcept {
+		return agent->Active && !agent->Sleeping && agent->Mode != TICK_MODE_MANUAL && agent->Tree.is_valid();
+	}
+
+	struct Sleeper {
+		RID Agent;
+		uint32_t SleepId;
+	};
+
+	void UpdateTickList(RID rid);
+	void RemoveFromTickList(Agent *agent);
+
+	void ConnectToSceneTree();
+	bool IsDue(const Agent *agent, TickMode mode) const noexcept;
+	void StartTick(Agent *agent, TickMode mode);
+
+	void ParkIfWaiting(Agent *agent, TickMode mode);
+	void WakeAgent(Agent *agent);
+	void CancelSleep(Agent *agent);
+
+	void TickAgents(TickMode mode);
+	void TickThreadedAgents(TickMode mode);
+	void TickThreadedAgent(uint32_t index, Agent **agents);
+	void FlushPendingChanges();
+
+private:
+	// runtimes of despawned pooled agents freed per tick once their pool is idle
+	static constexpr uint32_t PooledRuntimesFreedPerTick = 8;
+
+	static inline BehaviourTreeServer *Singleton = nullptr;
+
+	mutable RID_Owner<Agent> m_Agents;
+	size_t m_AgentsCount = 0;
+
+	std::vector<Agent *> m_TickLists[TICK_MODE_MANUAL];
+
+	// per tick list, agents are visited in a round-robin from the cursor when the budget runs out
+	uint64_t m_Frames[TICK_MODE_MANUAL]{};
+	double m_Times[TICK_MODE_MANUAL]{};
+	size_t m_Cursors[TICK_MODE_MANUAL]{};
+	uint64_t m_FrameBudgetUsec = 0;
+
+	// changes to the tick lists requested while they are being ticked, trees on the workers may wake agents up
+	// so the flag is read from their threads
+	SafeFlag m_IsTicking;
+	std::vector<RID> m_PendingUpdates;
+	std::vector<RID> m_PendingFrees;
+	Mutex m_PendingWakesLock;
+	std::vector<RID> m_PendingWakes;
+
+	// per tick list, on the time of the list
+	TimerWheel<Sleeper> m_TimerWheels[TICK_MODE_MANUAL];
+
+	bool m_IsConnected = false;
+
+	bool m_IsThreaded = false;
+	std::vector<Agent *> m_ThreadedAgents;
+};
+} //namespace behaviour_tree
+VARIANT_ENUM_CAST(behaviour_tree::BehaviourTreeServer::TickMode);
+VARIANT_ENUM_CAST(behaviour_tree::BehaviourTreeServer::TickRate);
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace behaviour_tree {
+/*
+Hierarchical timer wheel, timers are bucketed by their expiry time so advancing the wheel only visits the buckets
+that expired. Each level has 64 slots, a slot of a level covers a whole turn of the level below it:
+
+	level 0		64 slots of 'resolution'
+	level 1		64 slots of 64 * 'resolution'
+	...
+
+Timers of the higher levels are moved down when the level below wraps around. Timers can't be cancelled,
+the owner ignores the values that are no longer relevant when they expire.
+*/
+template <typename _Ty>
+class TimerWheel {
+public:
+	static constexpr uint32_t SlotBits = 6;
+	static constexpr uint32_t SlotCount = 1 << SlotBits;
+	static constexpr uint32_t SlotMask = SlotCount - 1;
+	static constexpr uint32_t LevelCount = 4;
+
+	explicit TimerWheel(uint64_t resolution_usec = 1000) noexcept :
+			m_Resolution(resolution_usec) {}
+
+	// Times are in microseconds and must be on the same clock as the one the wheel is advanced with
+	void Schedule(uint64_t expiry_usec, const _Ty &value) {
+		// rounded up, a timer never expires early
+		const uint64_t expiry = std::max((expiry_usec + m_Resolution - 1) / m_Resolution, m_Tick + 1);
+		Insert({ expiry, value });
+		m_Count++;
+	}
+
+	// Calls 'on_expired' with the value of each timer that expired by 'now_usec'
+	template <typename _Fn>
+	void Advance(uint64_t now_usec, _Fn &&on_expired) {
+		const uint64_t target = now_usec / m_Resolution;
+
+		// nothing to expire, the wheel can jump to the time directly
+		if (!m_Count) {
+			m_Tick = std::max(m_Tick, target);
+			return;
+		}
+
+		while (m_Tick < target && m_Count) {
+			m_Tick++;
+
+			// move the timers of the slots that are now due in the higher levels down, from the top
+			for (uint32_t level = LevelCount - 1; level > 0; level--) {
+				if (m_Tick & ((uint64_t(1) << (SlotBits * level)) - 1))
+					continue;
+				Cascade(level, (m_Tick >> (SlotBits * level)) & SlotMask);
+			}
+
+			std::vector<Entry> &slot = m_Slots[0][m_Tick & SlotMask];
+			if (slot.empty())
+				continue;
+
+			// timers may be scheduled again from the callback
+			m_Expired.swap(slot);
+			m_Count -= m_Expired.size();
+			for (const Entry &entry : m_Expired)
+				on_expired(entry.Value);
+			m_Expired.clear();
+		}
+		m_Tick = std::max(m_Tick, target);
+	}
+
+	size_t GetCount() const noexcept {
+		return m_Count;
+	}
+
+private:
+	struct Entry {
+		uint64_t Expiry;
+		_Ty Value;
+	};
+
+	void Insert(const Entry &entry) {
+		const uint64_t delta = entry.Expiry - m_Tick;
+
+		uint32_t level = 0;
+		while (level + 1 < LevelCount && delta >= (uint64_t(1) << (SlotBits * (level + 1))))
+			level++;
+
+		// timers past the last level wait in it and are placed again when their slot comes
+		uint64_t expiry = entry.Expiry;
+		if (delta >= (uint64_t(1) << (SlotBits * LevelCount)))
+			expiry = m_Tick + (uint64_t(1) << (SlotBits * LevelCount)) - 1;
+
+		m_Slots[level][(expiry >> (SlotBits * level)) & SlotMask].push_back(entry);
+	}
+
+	void Cascade(uint32_t level, uint64_t slot_index) {
+		std::vector<Entry> &slot = m_Slots[level][slot_index];
+		if (slot.empty())
+			return;
+
+		m_Cascaded.swap(slot);
+		for (const Entry &entry : m_Cascaded)
+			Insert({ std::max(entry.Expiry, m_Tick), entry.Value });
+		m_Cascaded.clear();
+	}
+
+private:
+	uint64_t m_Resolution;
+	uint64_t m_Tick = 0;
+	size_t m_Count = 0;
+
+	std::vector<Entry> m_Slots[LevelCount][SlotCount];
+	// reused buffers for the slots being processed
+	std::vector<Entry> m_Expired;
+	std::vector<Entry> m_Cascaded;
+};
+} //namespace behaviour_tree
@@ -1,11 +1,14 @@
-#include <queue>
-
 #include "nodes/CustomNodes.hpp"
 #include "tree.hpp"
+#include "server.hpp"
+#include "factory.hpp"
+#include "core/config/engine.h"
+#include "core/os/os.h"
 
 #include "decorator_node.hpp"
 #include "nodes/AlwaysFailureNode.hpp"
 #include "nodes/AlwaysSuccessNode.hpp"
+#include "nodes/BlackboardConditionNode.hpp"
 #include "nodes/ConverterNode.hpp"
 #include "nodes/LoopNode.hpp"
 #include "nodes/TimeOutNode.hpp"
@@ -30,8 +33,10 @@ using namespace godot;
 
 namespace behaviour_tree {
 void BehaviourTree::_bind_methods() {
-	ClassDB::bind_method(D_METHOD("execute_tree"), &BehaviourTree::ExecuteTree);
+	ClassDB::bind_method(D_METHOD("execute_tree", "delta"), &BehaviourTree::ExecuteTree, DEFVAL(-1.0));
 	ClassDB::bind_method(D_METHOD("set_always_running", "run_always"), &BehaviourTree::SetAlwaysRunning);
+	ClassDB::bind_method(D_METHOD("set_resume_running", "resume_running"), &BehaviourTree::SetResumeRunning);
+	ClassDB::bind_method(D_METHOD("is_resuming_running"), &BehaviourTree::IsResumingRunning);
 
 	ClassDB::bind_method(D_METHOD("rewind"), &BehaviourTree::Rewind);
 	ClassDB::bind_method(D_METHOD("initialize_tree"), &BehaviourTree::InitializeTree);
@@ -51,9 +56,24 @@ void BehaviourTree::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("_get_bt_nodes"), &BehaviourTree::GDGetNodes);
 	ADD_PROPERTY(PropertyInfo(Variant::ARRAY, "_bt_nodes", PROPERTY_HINT_ARRAY_TYPE, "", PROPERTY_USAGE_STORAGE), "_set_bt_nodes", "_get_bt_nodes");
 	
+	ClassDB::bind_method(D_METHOD("get_node_state", "node"), &BehaviourTree::GDGetNodeState);
+	ClassDB::bind_method(D_METHOD("get_tick_delta"), &BehaviourTree::GetTickDelta);
+	ClassDB::bind_method(D_METHOD("get_clock_time"), &BehaviourTree::GDGetClockTime);
+
+	ClassDB::bind_method(D_METHOD("set_clock_mode", "mode"), &BehaviourTree::SetClockMode);
+	ClassDB::bind_method(D_METHOD("get_clock_mode"), &BehaviourTree::GetClockMode);
+	ClassDB::bind_method(D_METHOD("set_allocation_mode", "mode"), &BehaviourTree::SetAllocationMode);
+	ClassDB::bind_method(D_METHOD("get_allocation_mode"), &BehaviourTree::GetAllocationMode);
+	ClassDB::bind_method(D_METHOD("set_fixed_step", "step"), &BehaviourTree::SetFixedStep);
+	ClassDB::bind_method(D_METHOD("get_fixed_step"), &BehaviourTree::GetFixedStep);
+
 	ClassDB::bind_method(D_METHOD("set_blackboard", "key", "data"), &BehaviourTree::SetBlackboard);
 	ClassDB::bind_method(D_METHOD("get_blackboard", "key"), &BehaviourTree::GetBlackboard);
 
+	ClassDB::bind_method(D_METHOD("get_blackboard_slot", "key"), &BehaviourTree::GDResolveBlackboardSlot);
+	ClassDB::bind_method(D_METHOD("set_blackboard_at", "slot", "data"), &BehaviourTree::SetBlackboardSlot);
+	ClassDB::bind_method(D_METHOD("get_blackboard_at", "slot"), &BehaviourTree::GetBlackboardSlot);
+
 #if TOOLS_ENABLED
 	ADD_SIGNAL(MethodInfo("_on_btree_execute"));
 #endif
@@ -65,29 +85,35 @@ void BehaviourTree::register_types() {
 	GDREGISTER_ABSTRACT_CLASS(IBehaviourTreeNodeBehaviour);
 
 	GDREGISTER_ABSTRACT_CLASS(IBehaviourTreeDecoratorNode);
-	GDREGISTER_CLASS(nodes::BehaviourTreeAlwaysFailureNode);
-	GDREGISTER_CLASS(nodes::BehaviourTreeAlwaysSuccessNode);
-	GDREGISTER_CLASS(nodes::BehaviourTreeConverterNode);
-	GDREGISTER_CLASS(nodes::BehaviourTreeLoopNode);
-	GDREGISTER_CLASS(nodes::BehaviourTreeTimeOutNode);
-	GDREGISTER_CLASS(nodes::BehaviourTreeCustomDecoratorNode);
-
 	GDREGISTER_ABSTRACT_CLASS(IBehaviourTreeActionNode);
-	GDREGISTER_CLASS(nodes::BehaviourTreeRefNode);
-	GDREGISTER_CLASS(nodes::BehaviourTreeBreakPointNode);
-	GDREGISTER_CLASS(nodes::BehaviourTreeCallFunctionNode);
-	GDREGISTER_CLASS(nodes::BehaviourTreeEmitSignalNode);
-	GDREGISTER_CLASS(nodes::BehaviourTreePrintMessageNode);
-	GDREGISTER_CLASS(nodes::BehaviourTreeWaitTimeNode);
-	GDREGISTER_CLASS(nodes::BehaviourTreeCustomActionNode);
-
 	GDREGISTER_ABSTRACT_CLASS(IBehaviourTreeCompositeNode);
-	GDREGISTER_CLASS(nodes::BehaviourTreeFallbackNode);
-	GDREGISTER_CLASS(nodes::BehaviourTreeInterruptorNode);
-	GDREGISTER_CLASS(nodes::BehaviourTreeParallelNode);
-	GDREGISTER_CLASS(nodes::BehaviourTreeRandomFallbackNode);
-	GDREGISTER_CLASS(nodes::BehaviourTreeRandomSequenceNode);
-	GDREGISTER_CLASS(nodes::BehaviourTreeSequenceNode);
+
+	BT_REGISTER_NODE(nodes::BehaviourTreeSequenceNode, "Sequence", "Common/Composites", "Executes the childrens from top to bottom and fails if any of them fails");
+	BT_REGISTER_NODE(nodes::BehaviourTreeParallelNode, "Parallel", "Common/Composites", "Executes the first two of childrens regardless of the previous state");
+	BT_REGISTER_NODE(nodes::BehaviourTreeFallbackNode, "Fallback", "Common/Composites", "Execute childrens from to bottom and immediatly succeed if any of them succeed");
+	BT_REGISTER_NODE(nodes::BehaviourTreeInterruptorNode, "Interruptor", "Common/Composites", "Executes the childrens and fails the rest in case any of them didn't fail");
+	BT_REGISTER_NODE(nodes::BehaviourTreeRandomSequenceNode, "Random Sequence", "Common/Composites", "Execute childrens in random order and fails if any of them fails");
+	BT_REGISTER_NODE(nodes::BehaviourTreeRandomFallbackNode, "Random fallback", "Common/Composites", "Execute childrens in random order and immediatly succeed if any of them succeed");
+
+	BT_REGISTER_NODE(nodes::BehaviourTreeAlwaysSuccessNode, "Always Success", "Common/Decorators", "Forces success state");
+	BT_REGISTER_NODE(nodes::BehaviourTreeAlwaysFailureNode, "Always Failure", "Common/Decorators", "Forces failure state");
+	BT_REGISTER_NODE(nodes::BehaviourTreeConverterNode, "Converter", "Common/Decorators", "Mutate the upcoming node state");
+	BT_REGISTER_NODE(nodes::BehaviourTreeTimeOutNode, "Timeout", "Common/Decorators", "Terminate execution if the wait time has exceeded");
+	BT_REGISTER_NODE(nodes::BehaviourTreeLoopNode, "Loop", "Common/Decorators", "Loops on execution of a node");
+	BT_REGISTER_NODE(nodes::BehaviourTreeBlackboardConditionNode, "Blackboard Condition", "Common/Decorators", "Executes the node while a blackboard key passes the condition");
+
+	BT_REGISTER_NODE(nodes::BehaviourTreeEmitSignalNode, "Emit Signal", "Common/Functions", "Emit a signal from current 'bt_node_object' in blackboard");
+	BT_REGISTER_NODE(nodes::BehaviourTreeCallFunctionNode, "Call Function", "Common/Functions", "Call a function from current 'bt_node_object' in blackboard");
+
+	BT_REGISTER_NODE(nodes::BehaviourTreeWaitTimeNode, "Wait Time", "Common/Actions", "Suspend execution for set period of time");
+	BT_REGISTER_NODE(nodes::BehaviourTreeRefNode, "Tree reference", "Common/Actions", "References an external behaviour tree");
+
+	BT_REGISTER_NODE(nodes::BehaviourTreePrintMessageNode, "Print", "Common/Debug", "Print a message to the console");
+	BT_REGISTER_NODE(nodes::BehaviourTreeBreakPointNode, "Break point", "Common/Debug", "Pauses the game");
+
+	// listed in the editor from the script classes that extend them
+	GDREGISTER_CLASS(nodes::BehaviourTreeCustomDecoratorNode);
+	GDREGISTER_CLASS(nodes::BehaviourTreeCustomActionNode);
 	GDREGISTER_CLASS(nodes::BehaviourTreeCustomCompositeNode);
 
 	BIND_CONSTANT(BEHAVIOUR_TREE_NODE_INACTIVE);
@@ -95,6 +121,13 @@ void BehaviourTree::register_types() {
 	BIND_CONSTANT(BEHAVIOUR_TREE_NODE_SUCCESS);
 	BIND_CONSTANT(BEHAVIOUR_TREE_NODE_FAILURE);
 
+	BIND_CONSTANT(BEHAVIOUR_TREE_CLOCK_GAME_TIME);
+	BIND_CONSTANT(BEHAVIOUR_TREE_CLOCK_UNSCALED);
+	BIND_CONSTANT(BEHAVIOUR_TREE_CLOCK_FIXED_STEP);
+
+	BIND_CONSTANT(BEHAVIOUR_TREE_ALLOCATION_DEFAULT);
+	BIND_CONSTANT(BEHAVIOUR_TREE_ALLOCATION_POOLED);
+
 	BTreeResLoader.instantiate();
 	BTreeResSaver.instantiate();
 
@@ -108,70 +141,153 @@ void BehaviourTree::unregister_types() {
 
 	BTreeResLoader.unref();
 	BTreeResSaver.unref();
+
+	BehaviourTreeProgram::ClearRuntimePools();
+	BehaviourTreeFactory::Clear();
+	nodes::CustomNodeHooks::Clear();
 }
 
 void BehaviourTree::reset_state() {
 	Rewind();
 }
 
-void BehaviourTree::Traverse(IBehaviourTreeNodeBehaviour *node, const std::function<void(IBehaviourTreeNodeBehaviour *)> &callback) {
-	std::queue<IBehaviourTreeNodeBehaviour *> nodes;
-	std::vector<IBehaviourTreeNodeBehaviour *> subnodes;
+void BehaviourTree::CompileProgram() {
+	m_ProgramDirty = false;
+	m_ProgramState.reset();
+
+	if (m_RootNodesIndex == -1)
+		return;
 
-	IBehaviourTreeNodeBehaviour *cur_node = node;
-	nodes.push(cur_node);
+	std::shared_ptr<const BehaviourTreeProgram> program = AcquireProgram();
+	if (!program)
+		return;
 
-	while (!nodes.empty()) {
-		for (size_t i = 0; i < nodes.size(); i++) {
-			IBehaviourTreeNodeBehaviour *cur_node = nodes.front();
-			nodes.pop();
+	m_ProgramState = std::make_unique<BehaviourTreeProgramState>(std::move(program), this, m_AllocationMode == BEHAVIOUR_TREE_ALLOCATION_POOLED);
+	if (m_IsInitialized)
+		m_ProgramState->InitializeNodes();
+}
 
-			callback(cur_node);
+std::shared_ptr<const BehaviourTreeProgram> BehaviourTree::AcquireProgram() {
+	const uint64_t key = m_Nodes[m_RootNodesIndex]->get_instance_id();
+	MutexLock lock(SharedProgramsLock);
 
-			cur_node->GetChildrens(subnodes);
-			for (auto sub_child : subnodes)
-				nodes.push(sub_child);
-			subnodes.clear();
-		}
+	auto iter = SharedPrograms.find(key);
+	if (iter != SharedPrograms.end()) {
+		std::shared_ptr<const BehaviourTreeProgram> program = iter->second.lock();
+		if (program && program->IsCompiledFrom(m_Nodes))
+			return program;
+	}
+
+	auto program = std::make_shared<BehaviourTreeProgram>();
+	if (!program->Compile(m_Nodes, m_RootNodesIndex))
+		return nullptr;
+
+	SharedPrograms[key] = program;
+	return program;
+}
+
+void BehaviourTree::InvalidateProgram() {
+	m_ProgramDirty = true;
+	InterruptSleep();
+	if (!m_ProgramState)
+		return;
+
+	// the nodes changed, trees compiled from now on can't reuse it
+	auto &program = m_ProgramState->GetProgram();
+	const uint64_t key = program->GetNodes()[0].Node->get_instance_id();
+
+	MutexLock lock(SharedProgramsLock);
+	auto iter = SharedPrograms.find(key);
+	if (iter != SharedPrograms.end() && iter->second.lock() == program)
+		SharedPrograms.erase(iter);
+}
+
+NodeThreading BehaviourTree::GetThreading() {
+	if (IsProgramStale())
+		CompileProgram();
+	return m_ProgramState ? m_ProgramState->GetProgram()->GetThreading() : NodeThreading::MainThread;
+}
+
+void BehaviourTree::FlushDeferredCalls() {
+	std::vector<std::function<void()>> calls;
+	calls.swap(m_DeferredCalls);
+	for (auto &call : calls)
+		call();
+}
+
+NodeState BehaviourTree::GetNodeState(size_t node_index) const {
+	ERR_FAIL_INDEX_V(node_index, m_Nodes.size(), NodeState::Inactive);
+
+	if (m_ProgramState && !m_ProgramDirty) {
+		const uint32_t index = m_ProgramState->GetProgram()->GetProgramIndex(node_index);
+		if (index != std::numeric_limits<uint32_t>::max())
+			return m_ProgramState->GetState(index);
+	}
+	return m_Nodes[node_index]->GetState();
+}
+
+void BehaviourTree::InterruptSleep() {
+	if (!m_IsSleeping)
+		return;
+
+	m_IsSleeping = false;
+	if (BehaviourTreeServer *server = BehaviourTreeServer::get_singleton())
+		server->AgentWake(m_Agent);
+}
+
+void BehaviourTree::AdvanceClock(double delta) {
+	if (delta < 0.0) {
+		delta = m_TickDelta;
+		m_TickDelta = -1.0;
+	}
 
-		cur_node = nodes.front();
+	// the system clock is only read when the delta isn't known
+	if (m_ClockMode == BEHAVIOUR_TREE_CLOCK_FIXED_STEP)
+		delta = m_FixedStep;
+	else if (m_ClockMode == BEHAVIOUR_TREE_CLOCK_UNSCALED || delta < 0.0) {
+		const uint64_t now = OS::get_singleton()->get_ticks_usec();
+		delta = m_LastExecuteUsec ? (now - m_LastExecuteUsec) / 1000000.0 : 0.0;
+		m_LastExecuteUsec = now;
+
+		if (m_ClockMode == BEHAVIOUR_TREE_CLOCK_GAME_TIME)
+			delta *= Engine::get_singleton()->get_time_scale();
 	}
+
+	m_Clock.Delta = delta;
+	m_Clock.TimeUsec += TickClock::ToUsec(delta);
 }
 
-void BehaviourTree::ExecuteTree() {
+void BehaviourTree::ExecuteTree(double delta) {
 	IBehaviourTreeNodeBehaviour *root = GetRootNode();
 	ERR_FAIL_COND(root == nullptr);
-	if (root->GetState() < NodeState::SuccessOrFailure || m_RunAlways) {
-		root->Execute();
+	if (IsProgramStale())
+		CompileProgram();
+
+	AdvanceClock(delta);
+
+	if (GetRootState() < NodeState::SuccessOrFailure || m_RunAlways) {
+		// trees that couldn't be compiled are executed through their nodes
+		if (m_ProgramState)
+			m_ProgramState->Execute(m_ResumeRunning);
+		else
+			root->Execute();
 #if TOOLS_ENABLED
-		emit_signal("_on_btree_execute");
+		if (m_IsDeferringCalls)
+			DeferCall([this]() { emit_signal("_on_btree_execute"); });
+		else
+			emit_signal("_on_btree_execute");
 #endif
-		if (m_RunAlways && root->GetState() >= NodeState::SuccessOrFailure)
+		if (m_RunAlways && GetRootState() >= NodeState::SuccessOrFailure)
 			Rewind();
 	}
 }
 
-Ref<IBehaviourTreeNodeBehaviour> BehaviourTree::GetParentOfNode(IBehaviourTreeNodeBehaviour *node) {
-	std::vector<IBehaviourTreeNodeBehaviour *> subnodes;
-	for (auto &cur_node : m_Nodes) {
-		if (cur_node == node)
-			continue;
-
-		cur_node->GetChildrens(subnodes);
-		if (!subnodes.empty()) {
-			if (std::find(subnodes.begin(), subnodes.end(), node) != subnodes.end())
-				return cur_node;
-			subnodes.clear();
-		}
-	}
-	return nullptr;
-}
-
 Ref<Resource> BehaviourTree::duplicate(bool) const {
 	Ref<BehaviourTree> copy;
 
 	copy.instantiate();
 	copy->SetAlwaysRunning(IsAlwaysRunning());
+	copy->SetAllocationMode(GetAllocationMode());
 	copy->GDSetRootNodeIndex(GDGetRootNodeIndex());
 
 	std::map<const IBehaviourTreeNodeBehaviour *, Ref<IBehaviourTreeNodeBehaviour>> final_nodes;
@@ -179,34 +295,48 @@ Ref<Resource> BehaviourTree::duplicate(bool) const {
 	// Load the new nodes and root nodes
 	for (size_t i = 0; i < m_Nodes.size(); i++) {
 		auto &node = m_Nodes[i];
-		Ref new_node = node->duplicate(true);
+		Ref<IBehaviourTreeNodeBehaviour> new_node = node->duplicate(true);
+		new_node->SetBehaviourTree(copy);
 
 		final_nodes.emplace(*node, new_node);
 		copy->m_Nodes.emplace_back(new_node);
 	}
 
 	// remap the node's childrens
-	std::vector<IBehaviourTreeNodeBehaviour *> subnodes;
 	for (auto &[cur_node, remap_parent] : final_nodes) {
-		cur_node->GetChildrens(subnodes);
+		NodeChildrens subnodes = cur_node->GetChildrens();
 		if (!subnodes.empty()) {
 			if (auto new_composite = Object::cast_to<IBehaviourTreeCompositeNode>(*remap_parent)) {
-				auto &childrens = new_composite->GetChildrens();
-				childrens.clear();
+				std::vector<Ref<IBehaviourTreeNodeBehaviour>> childrens;
+				childrens.reserve(subnodes.size());
 
-				for (auto &sub_node : subnodes) {
+				for (IBehaviourTreeNodeBehaviour *sub_node : subnodes) {
 					childrens.emplace_back(final_nodes[sub_node]);
 				}
+				new_composite->SetChildrens(std::move(childrens));
 			} else if (auto new_decorator = Object::cast_to<IBehaviourTreeDecoratorNode>(*remap_parent)) {
 				new_decorator->SetChild(final_nodes[subnodes[0]]);
 			}
-			subnodes.clear();
 		}
 	}
 
 	return copy;
 }
 
+Ref<BehaviourTree> BehaviourTree::CreateInstance() const {
+	Ref<BehaviourTree> instance;
+
+	instance.instantiate();
+	instance->m_Nodes = m_Nodes;
+	instance->m_RootNodesIndex = m_RootNodesIndex;
+	instance->m_RunAlways = m_RunAlways;
+	instance->m_ResumeRunning = m_ResumeRunning;
+	instance->m_AllocationMode = m_AllocationMode;
+	instance->m_IsUnique = true;
+
+	return instance;
+}
+
 void BehaviourTree::DisconnectConnectedNodes(IBehaviourTreeNodeBehaviour *node) {
 	Ref parent_node = GetParentOfNode(node);
 	if (parent_node.is_valid()) {
@@ -221,34 +351,10 @@ void BehaviourTree::setup_local_to_scene() {
 	if (m_IsUnique || !get_local_scene())
 		return;
 
+	// The nodes are shared with the other instances of the tree, only the nodes that the program
+	// executes through their objects are copied once the program is built, the rest is kept in its state
 	m_IsUnique = true;
-	std::map<Ref<IBehaviourTreeNodeBehaviour>, IBehaviourTreeNodeBehaviour *> final_nodes;
-
-	for (auto &node : m_Nodes) {
-		Ref<IBehaviourTreeNodeBehaviour> new_node = node->duplicate(true);
-		final_nodes.emplace(node, *new_node);
-		node = new_node;
-		node->SetBehaviourTree(this);
-	}
-
-	// remap the node's childrens
-	std::vector<IBehaviourTreeNodeBehaviour *> subnodes;
-	for (auto &[cur_node, remap_parent] : final_nodes) {
-		cur_node->GetChildrens(subnodes);
-		if (!subnodes.empty()) {
-			if (auto new_composite = Object::cast_to<IBehaviourTreeCompositeNode>(remap_parent)) {
-				auto &childrens = new_composite->GetChildrens();
-				childrens.clear();
-
-				for (auto &sub_node : subnodes) {
-					childrens.emplace_back(final_nodes[sub_node]);
-				}
-			} else if (auto new_decorator = Object::cast_to<IBehaviourTreeDecoratorNode>(remap_parent)) {
-				new_decorator->SetChild(final_nodes[subnodes[0]]);
-			}
-			subnodes.clear();
-		}
-	}
+	InvalidateProgram();
 }
 
 void BehaviourTreeHolder::_bind_methods() {
@@ -260,7 +366,49 @@ void BehaviourTreeHolder::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("_get_btree"), &BehaviourTreeHolder::GetBehaviourTree);
 	ADD_PROPERTY(PropertyInfo(Variant::OBJECT, "behaviour_tree", PROPERTY_HINT_RESOURCE_TYPE, "BehaviourTree"), "_set_btree", "_get_btree");
 
-	ClassDB::bind_method(D_METHOD("execute_tree"), &BehaviourTreeHolder::ExecuteTree);
+	ClassDB::bind_method(D_METHOD("set_tick_mode", "mode"), &BehaviourTreeHolder::SetTickMode);
+	ClassDB::bind_method(D_METHOD("get_tick_mode"), &BehaviourTreeHolder::GetTickMode);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "tick_mode", PROPERTY_HINT_ENUM, "Idle,Physics,Manual"), "set_tick_mode", "get_tick_mode");
+
+	ClassDB::bind_method(D_METHOD("set_tick_rate", "rate"), &BehaviourTreeHolder::SetTickRate);
+	ClassDB::bind_method(D_METHOD("get_tick_rate"), &BehaviourTreeHolder::GetTickRate);
+	ADD_PROPERTY(PropertyInfo(Variant::INT, "tick_rate", PROPERTY_HINT_ENUM, "Every Frame,Every 4th Frame,2 Hz"), "set_tick_rate", "get_tick_rate");
+
+	ClassDB::bind_method(D_METHOD("execute_tree", "delta"), &BehaviourTreeHolder::ExecuteTree, DEFVAL(-1.0));
+}
+
+BehaviourTreeHolder::~BehaviourTreeHolder() {
+	BehaviourTreeServer *server = BehaviourTreeServer::get_singleton();
+	if (m_Agent.is_valid() && server)
+		server->FreeRid(m_Agent);
+}
+
+void BehaviourTreeHolder::SetBehaviourTreeRes(const Ref<BehaviourTree> &tree) {
+	m_Tree = tree;
+	if (m_Agent.is_valid())
+		BehaviourTreeServer::get_singleton()->AgentSetTree(m_Agent, m_Tree);
+}
+
+void BehaviourTreeHolder::SetTickMode(int mode) {
+	m_TickMode = mode;
+	if (m_Agent.is_valid())
+		BehaviourTreeServer::get_singleton()->AgentSetTickMode(m_Agent, static_cast<BehaviourTreeServer::TickMode>(mode));
+}
+
+void BehaviourTreeHolder::SetTickRate(int rate) {
+	m_TickRate = rate;
+	if (m_Agent.is_valid())
+		BehaviourTreeServer::get_singleton()->AgentSetTickRate(m_Agent, static_cast<BehaviourTreeServer::TickRate>(rate));
+}
+
+void BehaviourTreeHolder::RegisterAgent() {
+	BehaviourTreeServer *server = BehaviourTreeServer::get_singleton();
+	if (m_Agent.is_valid() || !server)
+		return;
+
+	m_Agent = server->AgentCreate(m_Tree);
+	server->AgentSetTickMode(m_Agent, static_cast<BehaviourTreeServer::TickMode>(m_TickMode));
+	server->AgentSetTickRate(m_Agent, static_cast<BehaviourTreeServer::TickRate>(m_TickRate));
 }
 
 void BehaviourTreeHolder::_notification(int p_notification) {
@@ -271,11 +419,22 @@ void BehaviourTreeHolder::_notification(int p_notification) {
 			if (m_Tree.is_valid()) {
 				m_Tree->SetBlackboard("bt_target_node", get_node(GetTargetPath()));
 			}
+			if (m_Agent.is_valid())
+				BehaviourTreeServer::get_singleton()->AgentSetActive(m_Agent, can_process());
 			break;
 		}
 		case NOTIFICATION_READY: {
 			if (m_Tree.is_valid())
 				m_Tree->InitializeTree();
+			// the server ticks the tree from now on, once its tick mode isn't manual
+			RegisterAgent();
+			break;
+		}
+		case NOTIFICATION_PAUSED:
+		case NOTIFICATION_UNPAUSED:
+		case NOTIFICATION_EXIT_TREE: {
+			if (m_Agent.is_valid())
+				BehaviourTreeServer::get_singleton()->AgentSetActive(m_Agent, p_notification == NOTIFICATION_UNPAUSED);
 			break;
 		}
 	}
@@ -1,11 +1,16 @@
 #pragma once
 
 #include "node_behaviour.hpp"
+#include "composite_node.hpp"
+#include "decorator_node.hpp"
+#include "program.hpp"
 #include "scene/main/node.h"
 #include "resources.hpp"
+#include "core/os/mutex.h"
 
 #include <functional>
 #include <map>
+#include <memory>
 
 namespace behaviour_tree {
 class ResourceFormatLoaderBehaviourTree;
@@ -17,6 +22,18 @@ enum class NodeType {
 	Decorator
 };
 
+// Time of a tree, advanced once per execution so all the nodes read the same values
+struct TickClock {
+	// monotonic time of the tree
+	uint64_t TimeUsec = 0;
+	// seconds since the previous execution
+	double Delta = 0.0;
+
+	static uint64_t ToUsec(double seconds) noexcept {
+		return seconds > 0.0 ? static_cast<uint64_t>(seconds * 1000000.0) : 0;
+	}
+};
+
 class BehaviourTree : public Resource {
 	GDCLASS(BehaviourTree, Resource);
 
@@ -38,14 +55,41 @@ public:
 		BEHAVIOUR_TREE_NODE_FAILURE
 	};
 
-	Error LoadFromFile(const String &path, Ref<FileAccess> file = nullptr);
-	Error SaveToFile(const String &path, Ref<FileAccess> file = nullptr);
+	// Source of the time the tree clock advances by
+	enum BehaviourTreeClockMode {
+		// delta given to the execution, or the scaled time since the previous one
+		BEHAVIOUR_TREE_CLOCK_GAME_TIME,
+		// real time since the previous execution, ignores the time scale
+		BEHAVIOUR_TREE_CLOCK_UNSCALED,
+		// the fixed step on each execution, for deterministic replays
+		BEHAVIOUR_TREE_CLOCK_FIXED_STEP
+	};
+
+	// How the per agent runtime of the tree is allocated
+	enum BehaviourTreeAllocationMode {
+		// allocated for each agent and freed with it
+		BEHAVIOUR_TREE_ALLOCATION_DEFAULT,
+		// handed to the next agent running the same tree when the agent dies, for trees that are spawned in mass
+		BEHAVIOUR_TREE_ALLOCATION_POOLED
+	};
+
+	Error LoadFromFile(const String &path, const BehaviourTreeLoadOptions &options = {});
+	// Reads the tree from the cursor, it is left at the end of the tree
+	Error LoadFromBuffer(BufferReader &reader, const BehaviourTreeLoadOptions &options = {});
+	Error SaveToFile(const String &path);
+	void SaveToBuffer(BufferWriter &writer);
 
 	static inline Ref<ResourceFormatLoaderBehaviourTree> BTreeResLoader;
 	static inline Ref<ResourceFormatSaverBehaviourTree> BTreeResSaver;
 
 public:
-	static void Traverse(IBehaviourTreeNodeBehaviour *node, const std::function<void(IBehaviourTreeNodeBehaviour *)> &callback);
+	// Visits the node and its subtree in pre-order without allocating, trees with a program should use its ranges instead
+	template <typename _Fn>
+	static void Traverse(IBehaviourTreeNodeBehaviour *node, _Fn &&callback) {
+		callback(node);
+		for (IBehaviourTreeNodeBehaviour *child : node->GetChildrens())
+			Traverse(child, callback);
+	}
 
 	bool IsAlwaysRunning() const noexcept {
 		return m_RunAlways;
@@ -55,7 +99,33 @@ public:
 		m_RunAlways = value;
 	}
 
+	bool IsResumingRunning() const noexcept {
+		return m_ResumeRunning;
+	}
+
+	// Resume the next tick from the nodes that were left running instead of walking down from the root
+	void SetResumeRunning(bool value) {
+		m_ResumeRunning = value;
+		ClearRunningPath();
+	}
+
+	BehaviourTreeProgramState *GetProgramState() const noexcept {
+		return m_ProgramState.get();
+	}
+
+	void ClearRunningPath() {
+		if (m_ProgramState)
+			m_ProgramState->ClearRunningPath();
+		InterruptSleep();
+	}
+
 	void Rewind() {
+		InterruptSleep();
+		if (m_ProgramState) {
+			m_ProgramState->Rewind();
+			return;
+		}
+
 		if (m_RootNodesIndex == -1) {
 			for (auto &node : m_Nodes) {
 				node->Rewind();
@@ -68,14 +138,103 @@ public:
 	}
 
 	void InitializeTree() {
-		for (auto &node : m_Nodes) {
-			node->SetBehaviourTree(Ref(this));
-			node->Initialize();
+		m_IsInitialized = true;
+		CompileProgram();
+
+		// trees that couldn't be compiled are executed through their nodes
+		if (!m_ProgramState) {
+			for (auto &node : m_Nodes) {
+				node->SetBehaviourTree(Ref(this));
+				node->Initialize();
+			}
 		}
 	}
-	void ExecuteTree();
+	// A negative delta lets the tree compute it from its clock mode
+	void ExecuteTree(double delta = -1.0);
+
+	// The compiled form of the tree will be rebuilt on the next execution
+	void InvalidateProgram();
+
+	// State of the node for this tree, nodes can be shared with other trees and don't hold it themselves
+	NodeState GetNodeState(size_t node_index) const;
+
+	// Delta of the next execution, set by the server before it executes the tree
+	void SetTickDelta(double delta) noexcept {
+		m_TickDelta = delta;
+	}
+	double GetTickDelta() const noexcept {
+		return m_Clock.Delta;
+	}
+
+	const TickClock &GetClock() const noexcept {
+		return m_Clock;
+	}
+
+	void SetClockMode(int mode) noexcept {
+		m_ClockMode = static_cast<BehaviourTreeClockMode>(mode);
+	}
+	int GetClockMode() const noexcept {
+		return m_ClockMode;
+	}
+
+	// Clock time until which executing the tree would only keep its timers running, 0 if it has to be executed on every tick
+	uint64_t GetWakeTime() const noexcept {
+		if (!m_ProgramState || IsProgramStale() || m_ClockMode != BEHAVIOUR_TREE_CLOCK_GAME_TIME)
+			return 0;
+		return m_ProgramState->GetWakeTime();
+	}
+
+	// Agent of the server executing the tree, it is parked while the tree sleeps until its wake time
+	void SetAgent(RID agent) noexcept {
+		m_Agent = agent;
+	}
+	void SetSleeping(bool value) noexcept {
+		m_IsSleeping = value;
+	}
+	bool IsSleeping() const noexcept {
+		return m_IsSleeping;
+	}
+	// Wakes the agent before its wake time, when something else than time changed the tree
+	void InterruptSleep();
+
+	// Applies to the runtime allocated from the next compilation
+	void SetAllocationMode(int mode) noexcept {
+		m_AllocationMode = static_cast<BehaviourTreeAllocationMode>(mode);
+	}
+	int GetAllocationMode() const noexcept {
+		return m_AllocationMode;
+	}
+
+	void SetFixedStep(double step) noexcept {
+		m_FixedStep = step;
+	}
+	double GetFixedStep() const noexcept {
+		return m_FixedStep;
+	}
+
+	// Threads the tree can be executed from, compiles the tree if needed so it must be called from the main thread
+	NodeThreading GetThreading();
+
+	// Set while the tree is executed on a worker thread, nodes that touch the scene queue their effects instead
+	void SetDeferringCalls(bool value) noexcept {
+		m_IsDeferringCalls = value;
+	}
+	bool IsDeferringCalls() const noexcept {
+		return m_IsDeferringCalls;
+	}
+
+	void DeferCall(std::function<void()> call) {
+		m_DeferredCalls.emplace_back(std::move(call));
+	}
+	// Applies the queued effects, called from the main thread
+	void FlushDeferredCalls();
+
+	NodeState GetRootState() const {
+		return m_RootNodesIndex != -1 ? GetNodeState(m_RootNodesIndex) : NodeState::Inactive;
+	}
 
 	void SetRootNode(Ref<IBehaviourTreeNodeBehaviour> node) {
+		InvalidateProgram();
 		for (size_t i = 0; i < m_Nodes.size(); i++) {
 			if (m_Nodes[i] == node) {
 				m_RootNodesIndex = i;
@@ -90,6 +249,7 @@ public:
 			Object *node_obj = ClassDB::instantiate(node_name);
 			if (node_obj) {
 				Ref node = Object::cast_to<IBehaviourTreeNodeBehaviour>(node_obj);
+				node->SetBehaviourTree(this);
 				m_Nodes.push_back(node);
 				return node;
 			}
@@ -105,6 +265,7 @@ public:
 
 				DisconnectConnectedNodes(*node);
 				m_Nodes.erase(iter);
+				InvalidateProgram();
 				break;
 			}
 		}
@@ -117,10 +278,13 @@ public:
 
 			DisconnectConnectedNodes(*m_Nodes[index]);
 			m_Nodes.erase(m_Nodes.begin() + index);
+			InvalidateProgram();
 		}
 	}
 
-	Ref<IBehaviourTreeNodeBehaviour> GetParentOfNode(IBehaviourTreeNodeBehaviour *node);
+	Ref<IBehaviourTreeNodeBehaviour> GetParentOfNode(IBehaviourTreeNodeBehaviour *node) const {
+		return node ? node->GetParent() : nullptr;
+	}
 
 	auto &GetNodes() noexcept {
 		return m_Nodes;
@@ -135,22 +299,62 @@ public:
 	}
 
 	Ref<Resource> duplicate(bool) const override;
+	// Creates a tree that shares the nodes and the program of this one, with its own state and blackboard
+	Ref<BehaviourTree> CreateInstance() const;
 	void setup_local_to_scene() override;
 
-	void SetBlackboard(const String& key, const Variant& value) {
-		m_Blackboard[key] = value;
+	// Blackboard keys are interned once to a slot, nodes should resolve their keys when they are initialized
+	// and access the values through their slots
+	uint32_t ResolveBlackboardSlot(const StringName &key) {
+		auto iter = m_BlackboardSlots.find(key);
+		if (iter != m_BlackboardSlots.end())
+			return iter->second;
+
+		const uint32_t slot = static_cast<uint32_t>(m_BlackboardValues.size());
+		m_BlackboardSlots.emplace(key, slot);
+		m_BlackboardValues.emplace_back();
+		return slot;
+	}
+
+	const Variant &GetBlackboardSlot(uint32_t slot) const {
+		static const Variant nil;
+		ERR_FAIL_UNSIGNED_INDEX_V(slot, m_BlackboardValues.size(), nil);
+		return m_BlackboardValues[slot];
+	}
+	void SetBlackboardSlot(uint32_t slot, const Variant &value) {
+		ERR_FAIL_UNSIGNED_INDEX(slot, m_BlackboardValues.size());
+		Variant &current = m_BlackboardValues[slot];
+		if (current.get_type() == value.get_type() && current == value)
+			return;
+
+		current = value;
+		// conditions observing the key are evaluated on the next tick
+		if (m_ProgramState && m_ProgramState->OnBlackboardChanged(slot))
+			InterruptSleep();
+	}
+
+	void SetBlackboard(const String &key, const Variant &value) {
+		SetBlackboardSlot(ResolveBlackboardSlot(key), value);
 	}
-	Variant GetBlackboard(const String& key) const {
-		auto iter = m_Blackboard.find(key);
-		return iter != m_Blackboard.end() ? iter->second : Variant{};
+	Variant GetBlackboard(const String &key) const {
+		auto iter = m_BlackboardSlots.find(key);
+		return iter != m_BlackboardSlots.end() ? m_BlackboardValues[iter->second] : Variant{};
 	}
 
 private:
 	void DisconnectConnectedNodes(IBehaviourTreeNodeBehaviour *node);
+	// Invalidated, or compiled from nodes that were edited through another tree sharing them
+	bool IsProgramStale() const {
+		return m_ProgramDirty || (m_ProgramState && !m_ProgramState->GetProgram()->IsUpToDate());
+	}
+	void CompileProgram();
+	std::shared_ptr<const BehaviourTreeProgram> AcquireProgram();
+	void AdvanceClock(double delta);
 
 private:
 	void GDSetRootNodeIndex(int index) {
 		m_RootNodesIndex = index;
+		InvalidateProgram();
 	}
 
 	int GDGetRootNodeIndex() const {
@@ -160,8 +364,33 @@ private:
 	void GDSetNodes(const Array &nodes) {
 		m_Nodes.clear();
 		m_Nodes.reserve(nodes.size());
-		for (int i = 0; i < nodes.size(); i++)
-			m_Nodes.emplace_back(nodes[i]);
+		for (int i = 0; i < nodes.size(); i++) {
+			auto &node = m_Nodes.emplace_back(nodes[i]);
+			// local copies of the tree share the nodes, they stay owned by the first tree
+			if (node.is_valid() && node->GetBehaviourTree().is_null())
+				node->SetBehaviourTree(this);
+		}
+		for (auto &node : m_Nodes) {
+			if (node.is_valid())
+				node->LinkChildrens();
+		}
+		InvalidateProgram();
+	}
+
+	int GDResolveBlackboardSlot(const StringName &key) {
+		return static_cast<int>(ResolveBlackboardSlot(key));
+	}
+
+	int64_t GDGetClockTime() const {
+		return static_cast<int64_t>(m_Clock.TimeUsec);
+	}
+
+	int GDGetNodeState(const Ref<IBehaviourTreeNodeBehaviour> &node) const {
+		for (size_t i = 0; i < m_Nodes.size(); i++) {
+			if (m_Nodes[i] == node)
+				return static_cast<int>(GetNodeState(i));
+		}
+		return static_cast<int>(NodeState::Inactive);
 	}
 
 	Array GDGetNodes() const {
@@ -174,10 +403,38 @@ private:
 
 private:
 	std::vector<Ref<IBehaviourTreeNodeBehaviour>> m_Nodes;
-	std::map<String, Variant> m_Blackboard;
+	std::map<StringName, uint32_t> m_BlackboardSlots;
+	std::vector<Variant> m_BlackboardValues;
+
+	std::unique_ptr<BehaviourTreeProgramState> m_ProgramState;
+	bool m_ProgramDirty = true;
+	bool m_IsInitialized = false;
+
+	std::vector<std::function<void()>> m_DeferredCalls;
+	bool m_IsDeferringCalls = false;
+
+	// programs are shared by the trees that have the same nodes, keyed by the root node's instance id,
+	// they are only reused if none of their nodes was edited since they were compiled
+	static inline Mutex SharedProgramsLock;
+	static inline std::map<uint64_t, std::weak_ptr<const BehaviourTreeProgram>> SharedPrograms;
 
 	int m_RootNodesIndex = -1;
+
+	TickClock m_Clock;
+	BehaviourTreeClockMode m_ClockMode = BEHAVIOUR_TREE_CLOCK_GAME_TIME;
+	double m_FixedStep = 1.0 / 60.0;
+
+	BehaviourTreeAllocationMode m_AllocationMode = BEHAVIOUR_TREE_ALLOCATION_DEFAULT;
+	// delta injected by the server for the next execution, negative when there is none
+	double m_TickDelta = -1.0;
+	// real time of the previous execution, 0 before the first one
+	uint64_t m_LastExecuteUsec = 0;
+
+	RID m_Agent;
+	bool m_IsSleeping = false;
+
 	bool m_RunAlways = true;
+	bool m_ResumeRunning = false;
 	bool m_IsUnique = false;
 };
 
@@ -189,6 +446,8 @@ public:
 
 	void _notification(int p_notification);
 
+	~BehaviourTreeHolder();
+
 private:
 	void SetTargetPath(const NodePath &target_path) {
 		if (m_TargetPath != target_path) {
@@ -200,20 +459,36 @@ private:
 		return m_TargetPath;
 	}
 
-	void SetBehaviourTreeRes(const Ref<BehaviourTree> &tree) {
-		m_Tree = tree;
-	}
+	void SetBehaviourTreeRes(const Ref<BehaviourTree> &tree);
 	Ref<BehaviourTree> GetBehaviourTree() {
 		return m_Tree;
 	}
 
-	void ExecuteTree() {
-		m_Tree->ExecuteTree();
+	void SetTickMode(int mode);
+	int GetTickMode() const {
+		return m_TickMode;
+	}
+
+	void SetTickRate(int rate);
+	int GetTickRate() const {
+		return m_TickRate;
+	}
+
+	void ExecuteTree(double delta) {
+		m_Tree->ExecuteTree(delta);
 	}
 
+	void RegisterAgent();
+
 private:
 	NodePath m_TargetPath;
 	Ref<BehaviourTree> m_Tree;
+
+	// BehaviourTreeServer::TickMode and BehaviourTreeServer::TickRate, manual by default so the holders that
+	// already call 'execute_tree' don't run their tree twice
+	int m_TickMode = 2;
+	int m_TickRate = 0;
+	RID m_Agent;
 };
 } //namespace behaviour_tree
 VARIANT_ENUM_CAST(behaviour_tree::BehaviourTree::BehaviourTreeNodeState);
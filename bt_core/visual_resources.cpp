@@ -6,6 +6,7 @@
 
 #include "core/io/json.h"
 #include "core/io/resource_loader.h"
+#include "file_mapping.hpp"
 #include "visual_resources.hpp"
 
 #if TOOLS_ENABLED
@@ -56,60 +57,63 @@ void VisualBehaviourTree::unregister_types() {
 	VBTreeResSaver.unref();
 }
 
-Error VisualBehaviourTree::VLoadFromFile(const String &path) {
-	Error err = Error::OK;
-	Ref<FileAccess> file = FileAccess::open(path, FileAccess::READ, &err);
-
-	err = LoadFromFile(path, file);
+Error VisualBehaviourTree::VLoadFromFile(const String &path, const BehaviourTreeLoadOptions &options) {
+	FileMapping mapping;
+	Error err = mapping.Open(path);
+	if (err == Error::OK) {
+		BufferReader reader(mapping.GetData(), mapping.GetSize());
+		err = LoadFromBuffer(reader, options);
 #if TOOLS_ENABLED
-	ERR_FAIL_COND_V_MSG(err != Error::OK, err, "Failed to read visual behaviour tree from a file");
+		ERR_FAIL_COND_V_MSG(err != Error::OK, err, "Failed to read visual behaviour tree from a file");
 #endif
 
-	if (err == Error::OK) {
-		GDSetNodesDataPath(ReadStringFromFile(file));
+		if (err == Error::OK) {
+			GDSetNodesDataPath(reader.GetString());
 
-		size_t size = GetNodes().size();
-		m_NodesInfo.reserve(size);
+			size_t size = GetNodes().size();
+			m_NodesInfo.reserve(size);
 
-		for (size_t i = 0; i < size; i++) {
-			auto &node_info = m_NodesInfo.emplace_back();
+			for (size_t i = 0; i < size; i++) {
+				auto &node_info = m_NodesInfo.emplace_back();
 
-			node_info.Position.x = file->get_float();
-			node_info.Position.y = file->get_float();
-			node_info.Title = ReadStringFromFile(file);
-			node_info.Comment = ReadStringFromFile(file);
+				node_info.Position.x = reader.GetFloat();
+				node_info.Position.y = reader.GetFloat();
+				node_info.Title = reader.GetString();
+				node_info.Comment = reader.GetString();
+			}
+			ERR_FAIL_COND_V_MSG(reader.HasError(), Error::ERR_FILE_CORRUPT, "Visual behaviour tree file is truncated");
 		}
 	}
 	return err;
 }
 
 Error VisualBehaviourTree::VSaveToFile(const String &path) {
-	Error err = Error::OK;
-	Ref<FileAccess> file = FileAccess::open(path, FileAccess::WRITE, &err);
-
-#if TOOLS_ENABLED
-	ERR_FAIL_COND_V_MSG(err != Error::OK, err, "Failed to write visual behaviour tree to a file of path: " + path);
-#endif
-
-	SaveToFile(path, file);
+	// the tree and the editor data are serialized in memory first, a failure leaves the file untouched
+	BufferWriter writer;
+	SaveToBuffer(writer);
 
 	if (path.ends_with(".vbtree")) {
-		if (err == Error::OK) {
-			WriteStringToFile(file, GDGetNodesDataPath());
+		writer.StoreString(GDGetNodesDataPath());
 #if TOOLS_ENABLED
-			ERR_FAIL_COND_V(GetNodes().size() != m_NodesInfo.size(), Error::ERR_FILE_CORRUPT);
+		ERR_FAIL_COND_V(GetNodes().size() != m_NodesInfo.size(), Error::ERR_FILE_CORRUPT);
 #endif
 
-			for (auto &node_info : m_NodesInfo) {
-				file->store_float(node_info.Position.x);
-				file->store_float(node_info.Position.y);
-				WriteStringToFile(file, node_info.Title);
-				WriteStringToFile(file, node_info.Comment);
-			}
+		for (auto &node_info : m_NodesInfo) {
+			writer.StoreFloat(node_info.Position.x);
+			writer.StoreFloat(node_info.Position.y);
+			writer.StoreString(node_info.Title);
+			writer.StoreString(node_info.Comment);
 		}
 	}
 
-	return err;
+	Error err = Error::OK;
+	Ref<FileAccess> file = FileAccess::open(path, FileAccess::WRITE, &err);
+
+#if TOOLS_ENABLED
+	ERR_FAIL_COND_V_MSG(err != Error::OK, err, "Failed to write visual behaviour tree to a file of path: " + path);
+#endif
+
+	return writer.Flush(file);
 }
 
 void VisualBehaviourTree::GDSetNodesDataPath(const String &file_path) {
@@ -150,7 +154,7 @@ Ref<Resource> ResourceFormatLoaderVBehaviourTree::load(
 	if (r_error)
 		*r_error = OK;
 
-	Error err = res->VLoadFromFile(p_path);
+	Error err = res->VLoadFromFile(p_path, { p_use_sub_threads, r_progress, p_cache_mode });
 	if (r_error)
 		*r_error = err;
 
@@ -24,7 +24,7 @@ public:
 	static void unregister_types();
 
 public:
-	Error VLoadFromFile(const String &path);
+	Error VLoadFromFile(const String &path, const BehaviourTreeLoadOptions &options = {});
 	Error VSaveToFile(const String &path);
 
 	static inline Ref<ResourceFormatLoaderVBehaviourTree> VBTreeResLoader;
@@ -7,7 +7,8 @@ def can_build(env, platform):
 def get_doc_classes():
     return [
         "BehaviourTree",
-        "BehaviourTreeCustomActionNode"
+        "BehaviourTreeCustomActionNode",
+        "BehaviourTreeServer"
     ]
 
 def get_doc_path():
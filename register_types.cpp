@@ -29,8 +29,10 @@
 /*************************************************************************/
 
 #include "register_types.h"
+#include "core/config/engine.h"
 #include "core/object/class_db.h"
 
+#include "bt_core/server.hpp"
 #include "bt_core/tree.hpp"
 #include "bt_core/visual_resources.hpp"
 
@@ -41,10 +43,16 @@
 
 using namespace godot;
 
+static behaviour_tree::BehaviourTreeServer *behaviour_tree_server = nullptr;
+
 void initialize_behaviour_tree_module(ModuleInitializationLevel p_level) {
 	using namespace behaviour_tree;
 	if (p_level == MODULE_INITIALIZATION_LEVEL_SCENE) {
 		BehaviourTree::register_types();
+
+		GDREGISTER_CLASS(BehaviourTreeServer);
+		behaviour_tree_server = memnew(BehaviourTreeServer);
+		Engine::get_singleton()->add_singleton(Engine::Singleton("BehaviourTreeServer", BehaviourTreeServer::get_singleton()));
 #if TOOLS_ENABLED
 		VisualBehaviourTree::register_types();
 		GDREGISTER_CLASS(BehaviourTreeRemoteTreeHolder);
@@ -57,6 +65,10 @@ void initialize_behaviour_tree_module(ModuleInitializationLevel p_level) {
 void uninitialize_behaviour_tree_module(ModuleInitializationLevel p_level) {
 	using namespace behaviour_tree;
 	if (p_level == MODULE_INITIALIZATION_LEVEL_SCENE) {
+		if (behaviour_tree_server) {
+			memdelete(behaviour_tree_server);
+			behaviour_tree_server = nullptr;
+		}
 		BehaviourTree::unregister_types();
 #if TOOLS_ENABLED
 		VisualBehaviourTree::unregister_types();